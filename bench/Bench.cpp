@@ -0,0 +1,877 @@
+/*
+  Filename   : Bench.cpp
+  Author     : Jaysen Hippensteel
+  Course     : Varies
+  Assignment : -
+  Description: One benchmark harness for the containers and algorithms in
+               this archive: Array, List, SearchTree, SortUtils, heapSort,
+               josephus and the sieves. Every benchmark is timed with Timer
+               over sizes 10^2, 10^3, ... up to its own limit (at most
+               10^8), and the results are written as CSV or JSON so runs
+               from different commits can be diffed. Heap allocations made
+               while the timer runs are counted too.
+
+               Usage: Bench [--max <size>] [--filter <text>]
+                            [--format csv|json] [--out <file>]
+*/
+
+/************************************************************/
+// System includes
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+/************************************************************/
+// Local includes
+
+#include "../array/Array/Array.hpp"
+#include "../bst/bst/SearchTree.hpp"
+#include "../josephus/Josephus.h"
+#include "../linkedlist/List/List.hpp"
+#include "../sieve/Timer.hpp"
+#include "../sorts1/DivideAndConquer.hpp"
+#include "../sorts1/ExternalSort.hpp"
+
+/************************************************************/
+// Functions linked in from the other directories' sources
+
+void
+heapSort (std::vector<int>& sort);
+
+std::set<unsigned>
+sieveSet (unsigned N);
+std::set<unsigned>
+sieveVector (unsigned N);
+unsigned long
+sieveSegmented (unsigned N);
+unsigned long
+countPrimes (unsigned N);
+std::vector<uint16_t>
+sieveLinear (unsigned N, std::vector<unsigned>& primes);
+
+/************************************************************/
+
+// Every replaceable operator new in the program (plain, array, nothrow and
+// aligned) goes through countedAllocate, so benchmarks can report how many
+// allocations the timed code makes. Allocations made directly with malloc
+// (by C code or inside the standard library) are not counted.
+std::atomic<unsigned long> allocationCount {0};
+
+// Count one allocation and return it, or nullptr if it failed. Kept out of
+// line, along with countedFree, so GCC never sees a free inlined against
+// a new and warns that they do not match (-Wmismatched-new-delete).
+[[gnu::noinline]] void*
+countedAllocate (size_t size, size_t alignment) noexcept
+{
+  allocationCount.fetch_add (1, std::memory_order_relaxed);
+  if (size == 0)
+  {
+    size = 1;
+  }
+  if (alignment <= alignof (std::max_align_t))
+  {
+    return std::malloc (size);
+  }
+  // aligned_alloc wants a size that is a multiple of the alignment
+  return std::aligned_alloc (alignment,
+                             (size + alignment - 1) / alignment * alignment);
+}
+
+[[gnu::noinline]] void
+countedFree (void* p) noexcept
+{
+  std::free (p);
+}
+
+void*
+countedNew (size_t size, size_t alignment)
+{
+  if (void* p = countedAllocate (size, alignment))
+  {
+    return p;
+  }
+  throw std::bad_alloc ();
+}
+
+void*
+operator new (size_t size)
+{
+  return countedNew (size, alignof (std::max_align_t));
+}
+
+void*
+operator new[] (size_t size)
+{
+  return countedNew (size, alignof (std::max_align_t));
+}
+
+void*
+operator new (size_t size, std::align_val_t alignment)
+{
+  return countedNew (size, static_cast<size_t> (alignment));
+}
+
+void*
+operator new[] (size_t size, std::align_val_t alignment)
+{
+  return countedNew (size, static_cast<size_t> (alignment));
+}
+
+void*
+operator new (size_t size, const std::nothrow_t&) noexcept
+{
+  return countedAllocate (size, alignof (std::max_align_t));
+}
+
+void*
+operator new[] (size_t size, const std::nothrow_t&) noexcept
+{
+  return countedAllocate (size, alignof (std::max_align_t));
+}
+
+void*
+operator new (size_t size, std::align_val_t alignment,
+              const std::nothrow_t&) noexcept
+{
+  return countedAllocate (size, static_cast<size_t> (alignment));
+}
+
+void*
+operator new[] (size_t size, std::align_val_t alignment,
+                const std::nothrow_t&) noexcept
+{
+  return countedAllocate (size, static_cast<size_t> (alignment));
+}
+
+void
+operator delete (void* p) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete[] (void* p) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete (void* p, size_t) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete[] (void* p, size_t) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete (void* p, std::align_val_t) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete[] (void* p, std::align_val_t) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete (void* p, size_t, std::align_val_t) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete[] (void* p, size_t, std::align_val_t) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete (void* p, const std::nothrow_t&) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete[] (void* p, const std::nothrow_t&) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete (void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  countedFree (p);
+}
+
+void
+operator delete[] (void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+  countedFree (p);
+}
+
+// Timer that also counts the allocations between start and stop
+class BenchTimer
+{
+public:
+
+  void
+  start ()
+  {
+    m_allocations = allocationCount.load (std::memory_order_relaxed);
+    m_timer.start ();
+  }
+
+  void
+  stop ()
+  {
+    m_timer.stop ();
+    m_allocations =
+      allocationCount.load (std::memory_order_relaxed) - m_allocations;
+  }
+
+  double
+  getElapsedMs () const
+  {
+    return m_timer.getElapsedMs ();
+  }
+
+  unsigned long
+  getAllocations () const
+  {
+    return m_allocations;
+  }
+
+private:
+
+  Timer<> m_timer;
+  unsigned long m_allocations = 0;
+};
+
+// A benchmark times one run on n elements itself, so that building its
+// input is left out, and returns a value that depends on the result so the
+// work cannot be optimized away.
+struct Benchmark
+{
+  std::string name;
+  size_t maxSize;
+  std::function<long (size_t n, BenchTimer& timer)> run;
+};
+
+struct Result
+{
+  std::string name;
+  size_t size;
+  unsigned reps;
+  double minMs;
+  double medianMs;
+  double meanMs;
+  unsigned long allocations;
+  long check;
+};
+
+// Total time to spend repeating each benchmark at each size, so small
+// sizes get enough runs for a stable median
+const double TARGET_MS = 200;
+const unsigned MAX_REPS = 100;
+
+// n random ints, the same for every run so results are comparable
+std::vector<int>
+randomInts (size_t n)
+{
+  std::vector<int> v (n);
+  std::mt19937 rng (362);
+  for (int& x : v)
+  {
+    x = rng ();
+  }
+  return v;
+}
+
+// n ints with existing order for the adaptive sorts: ascending, descending,
+// or a sawtooth of ascending runs of 1000
+std::vector<int>
+orderedInts (size_t n, const std::string& order)
+{
+  std::vector<int> v (n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    v[i] = order == "sorted" ? i : order == "reversed" ? n - i : i % 1000;
+  }
+  return v;
+}
+
+// n random floats in [-1e6, 1e6), the same for every run
+std::vector<float>
+randomFloats (size_t n)
+{
+  std::vector<float> v (n);
+  std::mt19937 rng (362);
+  std::uniform_real_distribution<float> dist (-1e6, 1e6);
+  for (float& x : v)
+  {
+    x = dist (rng);
+  }
+  return v;
+}
+
+// n random ints dealt into k shards, each sorted, for the k-way merges
+std::vector<std::vector<int>>
+sortedShards (size_t n, size_t k)
+{
+  std::vector<int> v = randomInts (n);
+  std::vector<std::vector<int>> shards (k);
+  for (size_t i = 0; i < k; ++i)
+  {
+    shards[i].assign (v.begin () + n * i / k, v.begin () + n * (i + 1) / k);
+    SortUtils::sort (shards[i].begin (), shards[i].end ());
+  }
+  return shards;
+}
+
+// A uniquely named file in the temp directory, so concurrent runs cannot
+// collide, that is removed when it goes out of scope, even by an exception
+struct TempFile
+{
+  std::string path;
+
+  explicit TempFile (const std::string& prefix)
+  {
+    path = (std::filesystem::temp_directory_path () / (prefix + ".XXXXXX"))
+      .string ();
+    ::close (::mkstemp (path.data ()));
+  }
+
+  TempFile (const TempFile&) = delete;
+
+  ~TempFile ()
+  {
+    std::filesystem::remove (path);
+  }
+};
+
+std::vector<Benchmark>
+makeBenchmarks ()
+{
+  std::vector<Benchmark> benchmarks;
+
+  benchmarks.push_back ({"Array::push_back", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      timer.start ();
+      Array<int> a;
+      for (size_t i = 0; i < n; ++i)
+      {
+        a.push_back (i);
+      }
+      timer.stop ();
+      return (long) a.size ();
+    }});
+
+  benchmarks.push_back ({"Array::iterate", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      Array<int> a (n, 1);
+      timer.start ();
+      long sum = std::accumulate (a.begin (), a.end (), 0L);
+      timer.stop ();
+      return sum;
+    }});
+
+  benchmarks.push_back ({"List::push_back", 10000000,
+    [] (size_t n, BenchTimer& timer) {
+      timer.start ();
+      List<int> l;
+      for (size_t i = 0; i < n; ++i)
+      {
+        l.push_back (i);
+      }
+      timer.stop ();
+      return (long) l.size ();
+    }});
+
+  benchmarks.push_back ({"List::iterate", 10000000,
+    [] (size_t n, BenchTimer& timer) {
+      List<int> l (n, 1);
+      timer.start ();
+      long sum = std::accumulate (l.begin (), l.end (), 0L);
+      timer.stop ();
+      return sum;
+    }});
+
+  benchmarks.push_back ({"SearchTree::insert", 10000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> keys = randomInts (n);
+      timer.start ();
+      SearchTree<int> tree;
+      for (int k : keys)
+      {
+        tree.insert (k);
+      }
+      timer.stop ();
+      return (long) tree.size ();
+    }});
+
+  benchmarks.push_back ({"SearchTree::find", 10000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> keys = randomInts (n);
+      SearchTree<int> tree;
+      for (int k : keys)
+      {
+        tree.insert (k);
+      }
+      timer.start ();
+      long found = 0;
+      for (int k : keys)
+      {
+        found += tree.find (k) != tree.end ();
+      }
+      timer.stop ();
+      return found;
+    }});
+
+  benchmarks.push_back ({"SortUtils::merge_sort", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      SortUtils::merge_sort (v.begin (), v.end ());
+      timer.stop ();
+      return (long) std::is_sorted (v.begin (), v.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::parallel_merge_sort", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      SortUtils::parallel_merge_sort (v.begin (), v.end ());
+      timer.stop ();
+      return (long) std::is_sorted (v.begin (), v.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::bottom_up_merge_sort", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      SortUtils::bottom_up_merge_sort (v.begin (), v.end ());
+      timer.stop ();
+      return (long) std::is_sorted (v.begin (), v.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::adaptive_merge_sort", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      SortUtils::adaptive_merge_sort (v.begin (), v.end ());
+      timer.stop ();
+      return (long) std::is_sorted (v.begin (), v.end ());
+    }});
+
+  // Presorted, reversed and sawtooth inputs, where adaptive_merge_sort can
+  // use the existing runs and merge_sort cannot
+  for (std::string order : {"sorted", "reversed", "sawtooth"})
+  {
+    benchmarks.push_back ({"SortUtils::merge_sort(" + order + ")", 100000000,
+      [order] (size_t n, BenchTimer& timer) {
+        std::vector<int> v = orderedInts (n, order);
+        timer.start ();
+        SortUtils::merge_sort (v.begin (), v.end ());
+        timer.stop ();
+        return (long) std::is_sorted (v.begin (), v.end ());
+      }});
+    benchmarks.push_back ({"SortUtils::adaptive_merge_sort(" + order + ")",
+      100000000,
+      [order] (size_t n, BenchTimer& timer) {
+        std::vector<int> v = orderedInts (n, order);
+        timer.start ();
+        SortUtils::adaptive_merge_sort (v.begin (), v.end ());
+        timer.stop ();
+        return (long) std::is_sorted (v.begin (), v.end ());
+      }});
+  }
+
+  benchmarks.push_back ({"SortUtils::quick_sort", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      SortUtils::quick_sort (v.begin (), v.end ());
+      timer.stop ();
+      return (long) std::is_sorted (v.begin (), v.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::intro_sort", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      SortUtils::intro_sort (v.begin (), v.end ());
+      timer.stop ();
+      return (long) std::is_sorted (v.begin (), v.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::parallel_quick_sort", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      SortUtils::parallel_quick_sort (v.begin (), v.end ());
+      timer.stop ();
+      return (long) std::is_sorted (v.begin (), v.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::radix_sort", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      SortUtils::radix_sort (v.begin (), v.end ());
+      timer.stop ();
+      return (long) std::is_sorted (v.begin (), v.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::radix_sort(float)", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<float> v = randomFloats (n);
+      timer.start ();
+      SortUtils::radix_sort (v.begin (), v.end ());
+      timer.stop ();
+      return (long) std::is_sorted (v.begin (), v.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::quick_sort(float)", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<float> v = randomFloats (n);
+      timer.start ();
+      SortUtils::quick_sort (v.begin (), v.end ());
+      timer.stop ();
+      return (long) std::is_sorted (v.begin (), v.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::partition", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      int pivot = 0;  // about the median of randomInts
+      timer.start ();
+      auto [p1, p2] = SortUtils::partition (v.begin (), v.end (), pivot);
+      timer.stop ();
+      return (long) (p1 - v.begin ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::block_partition", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      int pivot = 0;  // about the median of randomInts
+      timer.start ();
+      auto [p1, p2] =
+        SortUtils::block_partition (v.begin (), v.end (), pivot);
+      timer.stop ();
+      return (long) (p1 - v.begin ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::nth_element", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      long median = *SortUtils::nth_element (v.begin (), v.end (), n / 2);
+      timer.stop ();
+      return median;
+    }});
+
+  benchmarks.push_back ({"SortUtils::select", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      long median = *SortUtils::select (v.begin (), v.end (), n / 2);
+      timer.stop ();
+      return median;
+    }});
+
+  benchmarks.push_back ({"SortUtils::multi_select(p50/p90/p99)", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      auto percentiles = SortUtils::multi_select (
+        v.begin (), v.end (), {n / 2, n * 9 / 10, n * 99 / 100});
+      timer.stop ();
+      return (long) *percentiles[2];
+    }});
+
+  benchmarks.push_back ({"SortUtils::parallel_nth_element", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      long median =
+        *SortUtils::parallel_nth_element (v.begin (), v.end (), n / 2);
+      timer.stop ();
+      return median;
+    }});
+
+  // 64 sorted shards merged in one pass, against merging them in pairs
+  // (log2 64 = 6 passes over the data)
+  benchmarks.push_back ({"SortUtils::kway_merge(k=64)", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<std::vector<int>> shards = sortedShards (n, 64);
+      std::vector<int> out (n);
+      timer.start ();
+      SortUtils::kway_merge (shards, out.begin ());
+      timer.stop ();
+      return (long) std::is_sorted (out.begin (), out.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::parallel_kway_merge(k=64)", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<std::vector<int>> shards = sortedShards (n, 64);
+      std::vector<int> out (n);
+      timer.start ();
+      SortUtils::parallel_kway_merge (shards, out.begin ());
+      timer.stop ();
+      return (long) std::is_sorted (out.begin (), out.end ());
+    }});
+
+  benchmarks.push_back ({"SortUtils::merge(pairwise k=64)", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<std::vector<int>> shards = sortedShards (n, 64);
+      timer.start ();
+      while (shards.size () > 1)
+      {
+        std::vector<std::vector<int>> merged;
+        for (size_t i = 0; i < shards.size (); i += 2)
+        {
+          std::vector<int> out (shards[i].size () + shards[i + 1].size ());
+          SortUtils::merge (shards[i].begin (), shards[i].end (),
+                            shards[i + 1].begin (), shards[i + 1].end (),
+                            out.begin ());
+          merged.push_back (std::move (out));
+        }
+        shards = std::move (merged);
+      }
+      timer.stop ();
+      return (long) std::is_sorted (shards[0].begin (), shards[0].end ());
+    }});
+
+  // File to file with buffers a quarter the size of the data, which makes
+  // 12 runs
+  benchmarks.push_back ({"SortUtils::external_sort(memory=n/4)", 10000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<uint64_t> keys (n);
+      std::mt19937_64 rng (362);
+      for (uint64_t& key : keys)
+      {
+        key = rng ();
+      }
+      TempFile input ("bench_external_in");
+      TempFile output ("bench_external_out");
+      std::ofstream (input.path, std::ios::binary).write (
+        reinterpret_cast<const char*> (keys.data ()), n * sizeof (uint64_t));
+      SortUtils::ExternalSortOptions options;
+      options.memory = n * sizeof (uint64_t) / 4 + 1;
+      options.tempDirectory = std::filesystem::temp_directory_path ();
+      timer.start ();
+      long count = SortUtils::external_sort<uint64_t> (input.path,
+                                                       output.path, options);
+      timer.stop ();
+      return count;
+    }});
+
+  benchmarks.push_back ({"heapSort", 10000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<int> v = randomInts (n);
+      timer.start ();
+      heapSort (v);
+      timer.stop ();
+      // heapSort orders from largest to smallest
+      return (long) std::is_sorted (v.rbegin (), v.rend ());
+    }});
+
+  benchmarks.push_back ({"josephus(k=3)", 10000000,
+    [] (size_t n, BenchTimer& timer) {
+      timer.start ();
+      long survivor = josephus (n, 3);
+      timer.stop ();
+      return survivor;
+    }});
+
+  // The set sieve takes about 20 seconds at 10^7, so it stops at 10^6
+  benchmarks.push_back ({"sieveSet", 1000000,
+    [] (size_t n, BenchTimer& timer) {
+      timer.start ();
+      long count = sieveSet (n).size ();
+      timer.stop ();
+      return count;
+    }});
+
+  benchmarks.push_back ({"sieveVector", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      timer.start ();
+      long count = sieveVector (n).size ();
+      timer.stop ();
+      return count;
+    }});
+
+  benchmarks.push_back ({"sieveSegmented", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      timer.start ();
+      long count = sieveSegmented (n);
+      timer.stop ();
+      return count;
+    }});
+
+  benchmarks.push_back ({"countPrimes", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      timer.start ();
+      long count = countPrimes (n);
+      timer.stop ();
+      return count;
+    }});
+
+  benchmarks.push_back ({"sieveLinear", 100000000,
+    [] (size_t n, BenchTimer& timer) {
+      std::vector<unsigned> primes;
+      timer.start ();
+      sieveLinear (n, primes);
+      timer.stop ();
+      return (long) primes.size ();
+    }});
+
+  return benchmarks;
+}
+
+// Run benchmark at size n until TARGET_MS has been spent (at least once and
+// at most MAX_REPS times), after one untimed warm-up run
+Result
+measure (const Benchmark& benchmark, size_t n)
+{
+  BenchTimer timer;
+  long check = benchmark.run (n, timer);
+  unsigned long allocations = timer.getAllocations ();
+  std::vector<double> times;
+  double spent = 0;
+  while (times.size () < MAX_REPS && (times.empty () || spent < TARGET_MS))
+  {
+    benchmark.run (n, timer);
+    times.push_back (timer.getElapsedMs ());
+    spent += timer.getElapsedMs ();
+  }
+  std::sort (times.begin (), times.end ());
+  size_t reps = times.size ();
+  double median = reps % 2 ? times[reps / 2]
+                           : (times[reps / 2 - 1] + times[reps / 2]) / 2;
+  return {benchmark.name, n, (unsigned) reps, times.front (), median,
+          spent / reps, allocations, check};
+}
+
+void
+writeCsv (std::ostream& out, const std::vector<Result>& results)
+{
+  out << "benchmark,size,reps,min_ms,median_ms,mean_ms,ns_per_element,"
+      << "allocations,check" << std::endl;
+  for (const Result& r : results)
+  {
+    out << r.name << ',' << r.size << ',' << r.reps << ',' << r.minMs << ','
+        << r.medianMs << ',' << r.meanMs << ','
+        << r.medianMs * 1e6 / r.size << ',' << r.allocations << ','
+        << r.check << std::endl;
+  }
+}
+
+void
+writeJson (std::ostream& out, const std::vector<Result>& results)
+{
+  out << "[" << std::endl;
+  for (size_t i = 0; i < results.size (); ++i)
+  {
+    const Result& r = results[i];
+    out << "  {\"benchmark\": \"" << r.name << "\", \"size\": " << r.size
+        << ", \"reps\": " << r.reps << ", \"min_ms\": " << r.minMs
+        << ", \"median_ms\": " << r.medianMs << ", \"mean_ms\": "
+        << r.meanMs << ", \"ns_per_element\": " << r.medianMs * 1e6 / r.size
+        << ", \"allocations\": " << r.allocations << ", \"check\": "
+        << r.check << "}"
+        << (i + 1 < results.size () ? "," : "") << std::endl;
+  }
+  out << "]" << std::endl;
+}
+
+int
+main (int argc, char* argv[])
+{
+  size_t maxSize = 100000000;
+  std::string filter;
+  std::string format = "csv";
+  std::string outName;
+  for (int i = 1; i < argc; i += 2)
+  {
+    std::string option (argv[i]);
+    if (i + 1 >= argc ||
+        (option != "--max" && option != "--filter" && option != "--format" &&
+         option != "--out"))
+    {
+      std::cerr << "Usage: " << argv[0] << " [--max <size>] "
+                << "[--filter <text>] [--format csv|json] [--out <file>]"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::string value (argv[i + 1]);
+    if (option == "--max")
+      maxSize = std::stod (value);
+    else if (option == "--filter")
+      filter = value;
+    else if (option == "--format")
+      format = value;
+    else
+      outName = value;
+  }
+  if (format != "csv" && format != "json")
+  {
+    std::cerr << "Unknown format: " << format << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<Result> results;
+  for (const Benchmark& benchmark : makeBenchmarks ())
+  {
+    if (benchmark.name.find (filter) == std::string::npos)
+    {
+      continue;
+    }
+    for (size_t n = 100; n <= std::min (maxSize, benchmark.maxSize);
+         n *= 10)
+    {
+      results.push_back (measure (benchmark, n));
+      // Progress goes to stderr so stdout stays machine readable
+      std::cerr << benchmark.name << " n=" << n << ": "
+                << results.back ().medianMs << " ms" << std::endl;
+    }
+  }
+
+  std::ofstream file;
+  if (!outName.empty ())
+  {
+    file.open (outName);
+    if (!file)
+    {
+      std::cerr << "Could not write " << outName << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream& out = outName.empty () ? std::cout : file;
+  if (format == "csv")
+    writeCsv (out, results);
+  else
+    writeJson (out, results);
+  return 0;
+}
@@ -24,6 +24,15 @@
 /************************************************************/
 // Local includes
 
+// Build with -DTRACE_REGIONS -I../../sieve to time the regions marked with
+// TRACE_REGION (see sieve/Trace.hpp); otherwise they compile to nothing.
+#ifdef TRACE_REGIONS
+#include "Trace.hpp"
+#endif
+#ifndef TRACE_REGION
+#define TRACE_REGION(name)
+#endif
+
 /************************************************************/
 // Using declarations
 
@@ -316,6 +325,7 @@ public:
   std::pair<iterator, bool>
   insert (const T& v)
   {
+    TRACE_REGION ("SearchTree::insert");
     NodePtr insertedNode = insert (v, m_header.parent, &m_header);
     bool inserted = insertedNode != nullptr;
     if (inserted)
@@ -449,15 +459,14 @@ private:
     if(v > r->data){
       return findHelper(r->right, v);
     }
-    if(v < r->data){
-      return findHelper(r->left, v);
-    }
+    return findHelper(r->left, v);
   }
 
   NodePtr
   insert (const T& v, NodePtr& r, NodePtr parent)
   {
     if (r == nullptr){
+      TRACE_REGION ("allocate");
       r = new Node(v, nullptr, nullptr, parent);
       ++m_size;
       return r;
@@ -88,6 +88,9 @@ void heapSort(std::vector<int>& sort){
   
 }
 
+// Left out when HeapSort.cpp is linked into another program, such as the
+// benchmark suite in bench/
+#ifndef HEAPSORT_NO_MAIN
 int 
 main ()  
 {
@@ -99,3 +102,4 @@ main ()
  }
  return 0;
 }
+#endif
@@ -0,0 +1,266 @@
+/*
+  Filename   : BitKernels.hpp
+  Author     : Jaysen Hippensteel
+  Course     : CSMC 362
+  Assignment : Sieve Of Eratosthenes
+  Description: Pre-sieve and popcount kernels for the mod 30 wheel bitmap
+               (see WHEEL in Wheel.hpp). Each kernel has a portable
+               scalar version and an AVX2 version, and the unsuffixed
+               function picks one at runtime from the CPU's features.
+*/
+
+/************************************************************/
+// Macro guard to prevent multiple inclusions
+
+#ifndef BIT_KERNELS_H
+#define BIT_KERNELS_H
+
+/************************************************************/
+// System includes
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BIT_KERNELS_X86 1
+#endif
+
+/************************************************************/
+// Local includes
+
+#include "Wheel.hpp"
+
+/************************************************************/
+// Using declarations
+
+/************************************************************/
+
+namespace BitKernels
+{
+
+// Primes whose multiples are stamped by presieve. 2, 3 and 5 are already
+// left out of the wheel, so these are the primes from 7 to 19.
+const unsigned PRESIEVE_PRIMES[5] = {7, 11, 13, 17, 19};
+
+// Bytes loaded or stored at once by the AVX2 kernels
+const uint64_t VECTOR_BYTES = 32;
+
+// Pattern of wheel bytes with the multiples of every prime in primes
+// cleared. A multiple of p in byte i is also one in byte i + p, so the
+// pattern repeats every product-of-primes bytes. It is stored with an extra
+// VECTOR_BYTES so a vector load starting anywhere in one period stays inside.
+struct Pattern
+{
+  std::vector<unsigned char> bytes;
+  uint64_t period;
+
+  explicit Pattern (std::vector<unsigned> primes)
+  {
+    period = 1;
+    for (unsigned p : primes)
+    {
+      period *= p;
+    }
+    bytes.assign (period + VECTOR_BYTES, 0xFF);
+    for (uint64_t i = 0; i < bytes.size (); ++i)
+    {
+      for (unsigned b = 0; b < 8; ++b)
+      {
+        for (unsigned p : primes)
+        {
+          if ((30 * i + WHEEL[b]) % p == 0)
+          {
+            bytes[i] &= ~(1 << b);
+          }
+        }
+      }
+    }
+  }
+};
+
+// 7 * 11 * 13 = 1001 bytes and 17 * 19 = 323 bytes
+inline const Pattern&
+patternLow ()
+{
+  static const Pattern pattern ({7, 11, 13});
+  return pattern;
+}
+
+inline const Pattern&
+patternHigh ()
+{
+  static const Pattern pattern ({17, 19});
+  return pattern;
+}
+
+// Clear the bits of the multiples of 7 to 19 in wheel[0, bytes),
+// overwriting whatever was there. The primes 7 to 19 themselves are cleared
+// too; the caller restores them. Stores 8 bytes at a time.
+inline void
+presieveScalar (unsigned char* wheel, uint64_t bytes)
+{
+  const Pattern& low = patternLow ();
+  const Pattern& high = patternHigh ();
+  uint64_t lowOffset = 0;
+  uint64_t highOffset = 0;
+  uint64_t i = 0;
+  for (; i + 8 <= bytes; i += 8)
+  {
+    uint64_t a;
+    uint64_t b;
+    std::memcpy (&a, &low.bytes[lowOffset], sizeof a);
+    std::memcpy (&b, &high.bytes[highOffset], sizeof b);
+    a &= b;
+    std::memcpy (wheel + i, &a, sizeof a);
+    lowOffset += 8;
+    if (lowOffset >= low.period)
+    {
+      lowOffset -= low.period;
+    }
+    highOffset += 8;
+    if (highOffset >= high.period)
+    {
+      highOffset -= high.period;
+    }
+  }
+  for (; i < bytes; ++i)
+  {
+    wheel[i] = low.bytes[i % low.period] & high.bytes[i % high.period];
+  }
+}
+
+// Return the number of set bits in bits[0, bytes).
+inline uint64_t
+popcountScalar (const unsigned char* bits, uint64_t bytes)
+{
+  uint64_t count = 0;
+  uint64_t i = 0;
+  for (; i + 8 <= bytes; i += 8)
+  {
+    uint64_t word;
+    std::memcpy (&word, bits + i, sizeof word);
+    count += std::popcount (word);
+  }
+  for (; i < bytes; ++i)
+  {
+    count += std::popcount (bits[i]);
+  }
+  return count;
+}
+
+#ifdef BIT_KERNELS_X86
+
+// presieveScalar with 32 byte stores. Each pattern is read with an
+// unaligned load at a rolling offset into its period.
+__attribute__ ((target ("avx2"))) inline void
+presieveAvx2 (unsigned char* wheel, uint64_t bytes)
+{
+  const Pattern& low = patternLow ();
+  const Pattern& high = patternHigh ();
+  uint64_t lowOffset = 0;
+  uint64_t highOffset = 0;
+  uint64_t i = 0;
+  for (; i + VECTOR_BYTES <= bytes; i += VECTOR_BYTES)
+  {
+    __m256i a = _mm256_loadu_si256 (
+      reinterpret_cast<const __m256i*> (&low.bytes[lowOffset]));
+    __m256i b = _mm256_loadu_si256 (
+      reinterpret_cast<const __m256i*> (&high.bytes[highOffset]));
+    _mm256_storeu_si256 (reinterpret_cast<__m256i*> (wheel + i),
+                         _mm256_and_si256 (a, b));
+    lowOffset += VECTOR_BYTES;
+    if (lowOffset >= low.period)
+    {
+      lowOffset -= low.period;
+    }
+    highOffset += VECTOR_BYTES;
+    if (highOffset >= high.period)
+    {
+      highOffset -= high.period;
+    }
+  }
+  for (; i < bytes; ++i)
+  {
+    wheel[i] = low.bytes[i % low.period] & high.bytes[i % high.period];
+  }
+}
+
+// popcountScalar 32 bytes at a time: each nibble's count is looked up with
+// a byte shuffle, and the byte counts are summed into 64 bit lanes.
+__attribute__ ((target ("avx2"))) inline uint64_t
+popcountAvx2 (const unsigned char* bits, uint64_t bytes)
+{
+  const __m256i table = _mm256_setr_epi8 (0, 1, 1, 2, 1, 2, 2, 3,
+                                          1, 2, 2, 3, 2, 3, 3, 4,
+                                          0, 1, 1, 2, 1, 2, 2, 3,
+                                          1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i nibble = _mm256_set1_epi8 (0x0F);
+  __m256i total = _mm256_setzero_si256 ();
+  uint64_t i = 0;
+  for (; i + VECTOR_BYTES <= bytes; i += VECTOR_BYTES)
+  {
+    __m256i v = _mm256_loadu_si256 (
+      reinterpret_cast<const __m256i*> (bits + i));
+    __m256i lo = _mm256_shuffle_epi8 (table, _mm256_and_si256 (v, nibble));
+    __m256i hi = _mm256_shuffle_epi8 (
+      table, _mm256_and_si256 (_mm256_srli_epi16 (v, 4), nibble));
+    total = _mm256_add_epi64 (
+      total, _mm256_sad_epu8 (_mm256_add_epi8 (lo, hi),
+                              _mm256_setzero_si256 ()));
+  }
+  uint64_t count = _mm256_extract_epi64 (total, 0) +
+                   _mm256_extract_epi64 (total, 1) +
+                   _mm256_extract_epi64 (total, 2) +
+                   _mm256_extract_epi64 (total, 3);
+  return count + popcountScalar (bits + i, bytes - i);
+}
+
+#endif
+
+// True if the AVX2 kernels can run on this CPU
+inline bool
+hasAvx2 ()
+{
+#ifdef BIT_KERNELS_X86
+  static const bool avx2 = __builtin_cpu_supports ("avx2");
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+inline void
+presieve (unsigned char* wheel, uint64_t bytes)
+{
+#ifdef BIT_KERNELS_X86
+  if (hasAvx2 ())
+  {
+    presieveAvx2 (wheel, bytes);
+    return;
+  }
+#endif
+  presieveScalar (wheel, bytes);
+}
+
+inline uint64_t
+popcount (const unsigned char* bits, uint64_t bytes)
+{
+#ifdef BIT_KERNELS_X86
+  if (hasAvx2 ())
+  {
+    return popcountAvx2 (bits, bytes);
+  }
+#endif
+  return popcountScalar (bits, bytes);
+}
+
+} // end namespace BitKernels
+
+/************************************************************/
+
+#endif
+
+/************************************************************/
@@ -0,0 +1,291 @@
+/*
+  Filename   : PrimeBitmap.hpp
+  Author     : Jaysen Hippensteel
+  Course     : CSMC 362
+  Assignment : Sieve Of Eratosthenes
+  Description: A precomputed mod 30 wheel bitmap of the primes up to N,
+               saved to disk with a rank index so that later runs can mmap
+               it and answer Pi[x] and range counts in O(1).
+
+               File layout (all integers in native byte order, so a file
+               only reads back on a machine of the same endianness):
+                 [0, 64)      magic "PRIMEBM1", N, bitmap bytes, blocks
+                 [64, ...)    rank: blocks + 1 uint32 values, where rank[k]
+                              is the number of set bits before block k
+                 (64 aligned) bitmap: blocks * 64 bytes of wheel bits
+               A block is 64 bytes, i.e. 512 bits covering 1920 integers.
+*/
+
+/************************************************************/
+// Macro guard to prevent multiple inclusions
+
+#ifndef PRIME_BITMAP_H
+#define PRIME_BITMAP_H
+
+/************************************************************/
+// System includes
+
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/************************************************************/
+// Local includes
+
+#include "Wheel.hpp"
+
+/************************************************************/
+// Using declarations
+
+/************************************************************/
+
+class PrimeBitmap
+{
+public:
+
+  // Bytes of bitmap per rank entry (512 bits)
+  static const uint64_t BLOCK_BYTES = 64;
+
+  // Write the wheel bitmap for the primes up to N (as returned by
+  // sieveWheel) to filename along with its rank index.
+  // Returns false if the file could not be written.
+  static bool
+  write (const std::string& filename, uint64_t N,
+         const std::vector<unsigned char>& wheel)
+  {
+    uint64_t bytes = N / 30 + 1;
+    uint64_t blocks = (bytes + BLOCK_BYTES - 1) / BLOCK_BYTES;
+
+    // Copies the bitmap into whole blocks, zero padded
+    std::vector<unsigned char> bitmap (blocks * BLOCK_BYTES, 0);
+    std::memcpy (bitmap.data (), wheel.data (), bytes);
+
+    std::vector<uint32_t> rank (blocks + 1, 0);
+    for (uint64_t k = 0; k < blocks; ++k)
+    {
+      rank[k + 1] = rank[k] + popcount (&bitmap[k * BLOCK_BYTES],
+                                        BLOCK_BYTES);
+    }
+
+    unsigned char header[HEADER_BYTES] = {};
+    uint64_t fields[3] = {N, bytes, blocks};
+    std::memcpy (header, MAGIC, 8);
+    std::memcpy (header + 8, fields, sizeof fields);
+
+    FILE* file = std::fopen (filename.c_str (), "wb");
+    if (file == nullptr)
+    {
+      return false;
+    }
+    std::vector<unsigned char> padding (bitmapOffset (blocks) - HEADER_BYTES
+                                        - rank.size () * sizeof (uint32_t), 0);
+    bool ok =
+      std::fwrite (header, 1, HEADER_BYTES, file) == HEADER_BYTES &&
+      std::fwrite (rank.data (), sizeof (uint32_t), rank.size (), file)
+        == rank.size () &&
+      std::fwrite (padding.data (), 1, padding.size (), file)
+        == padding.size () &&
+      std::fwrite (bitmap.data (), 1, bitmap.size (), file) == bitmap.size ();
+    return std::fclose (file) == 0 && ok;
+  }
+
+  // Map a bitmap file written by write. Check isOpen afterwards.
+  explicit PrimeBitmap (const std::string& filename)
+  {
+    int fd = ::open (filename.c_str (), O_RDONLY);
+    if (fd < 0)
+    {
+      return;
+    }
+    struct stat info;
+    if (::fstat (fd, &info) == 0 && (uint64_t) info.st_size >= HEADER_BYTES)
+    {
+      void* data = ::mmap (nullptr, info.st_size, PROT_READ, MAP_SHARED,
+                           fd, 0);
+      if (data != MAP_FAILED)
+      {
+        m_data = static_cast<const unsigned char*> (data);
+        m_size = info.st_size;
+      }
+    }
+    ::close (fd);
+    if (m_data == nullptr)
+    {
+      return;
+    }
+
+    // Validates the header before trusting any offsets in it: the sizes
+    // must be the ones write derives from N, and the block count is
+    // bounded by the file size before it goes into any offset, so a
+    // corrupt header cannot overflow them
+    uint64_t fields[3];
+    std::memcpy (fields, m_data + 8, sizeof fields);
+    m_n = fields[0];
+    uint64_t bytes = fields[1];
+    m_blocks = fields[2];
+    if (std::memcmp (m_data, MAGIC, 8) != 0 ||
+        bytes != m_n / 30 + 1 ||
+        m_blocks != (bytes + BLOCK_BYTES - 1) / BLOCK_BYTES ||
+        m_blocks > m_size / BLOCK_BYTES ||
+        m_size < bitmapOffset (m_blocks) + m_blocks * BLOCK_BYTES)
+    {
+      ::munmap (const_cast<unsigned char*> (m_data), m_size);
+      m_data = nullptr;
+      return;
+    }
+    m_rank = reinterpret_cast<const uint32_t*> (m_data + HEADER_BYTES);
+    m_bitmap = m_data + bitmapOffset (m_blocks);
+  }
+
+  PrimeBitmap (const PrimeBitmap&) = delete;
+
+  PrimeBitmap&
+  operator= (const PrimeBitmap&) = delete;
+
+  ~PrimeBitmap ()
+  {
+    if (m_data != nullptr)
+    {
+      ::munmap (const_cast<unsigned char*> (m_data), m_size);
+    }
+  }
+
+  bool
+  isOpen () const
+  {
+    return m_data != nullptr;
+  }
+
+  // Largest integer covered by the bitmap
+  uint64_t
+  limit () const
+  {
+    return m_n;
+  }
+
+  // Return the number of primes <= x, for x <= limit ().
+  // One rank lookup plus at most 8 word popcounts.
+  uint64_t
+  pi (uint64_t x) const
+  {
+    // 2, 3 and 5 are not stored on the wheel
+    uint64_t count = (x >= 2) + (x >= 3) + (x >= 5);
+    if (x < 7)
+    {
+      return count;
+    }
+    uint64_t byte = x / 30;
+    uint64_t block = byte / BLOCK_BYTES;
+    count += m_rank[block];
+    count += popcount (m_bitmap + block * BLOCK_BYTES,
+                       byte - block * BLOCK_BYTES);
+
+    // Counts the bits of the last byte that stand for integers <= x
+    unsigned residue = x % 30;
+    for (unsigned b = 0; b < 8 && WHEEL[b] <= residue; ++b)
+    {
+      count += (m_bitmap[byte] >> b) & 1;
+    }
+    return count;
+  }
+
+  // Return the number of primes in [a, b], for b <= limit ().
+  uint64_t
+  count (uint64_t a, uint64_t b) const
+  {
+    if (a > b)
+    {
+      return 0;
+    }
+    return pi (b) - (a == 0 ? 0 : pi (a - 1));
+  }
+
+  // Call visit(p) for every prime p in [a, b] in increasing order, reading
+  // straight from the mapped file. Requires b <= limit ().
+  template<typename Callback>
+  void
+  forEach (uint64_t a, uint64_t b, Callback visit) const
+  {
+    for (uint64_t p : {2, 3, 5})
+    {
+      if (a <= p && p <= b)
+      {
+        visit (p);
+      }
+    }
+    if (b < 7)
+    {
+      return;
+    }
+    for (uint64_t byte = a / 30; byte <= b / 30; ++byte)
+    {
+      unsigned bits = m_bitmap[byte];
+      while (bits != 0)
+      {
+        uint64_t p = 30 * byte + WHEEL[std::countr_zero (bits)];
+        if (p > b)
+        {
+          return;
+        }
+        if (p >= a)
+        {
+          visit (p);
+        }
+        bits &= bits - 1;
+      }
+    }
+  }
+
+private:
+
+  static constexpr char MAGIC[8] = {'P', 'R', 'I', 'M', 'E', 'B', 'M', '1'};
+  static const uint64_t HEADER_BYTES = 64;
+
+  // Offset of the bitmap: after the rank index, rounded up to a block
+  static uint64_t
+  bitmapOffset (uint64_t blocks)
+  {
+    uint64_t end = HEADER_BYTES + (blocks + 1) * sizeof (uint32_t);
+    return (end + BLOCK_BYTES - 1) / BLOCK_BYTES * BLOCK_BYTES;
+  }
+
+  // Number of set bits in the first bytes of bits
+  static uint64_t
+  popcount (const unsigned char* bits, uint64_t bytes)
+  {
+    uint64_t count = 0;
+    uint64_t i = 0;
+    for (; i + 8 <= bytes; i += 8)
+    {
+      uint64_t word;
+      std::memcpy (&word, bits + i, sizeof word);
+      count += std::popcount (word);
+    }
+    for (; i < bytes; ++i)
+    {
+      count += std::popcount (bits[i]);
+    }
+    return count;
+  }
+
+  const unsigned char* m_data = nullptr;
+  uint64_t m_size = 0;
+  uint64_t m_n = 0;
+  uint64_t m_blocks = 0;
+  const uint32_t* m_rank = nullptr;
+  const unsigned char* m_bitmap = nullptr;
+};
+
+/************************************************************/
+
+#endif
+
+/************************************************************/
@@ -4,67 +4,219 @@
  Date: 10/21/25
  Assignment: Sieve Of Eratosthenes
  Description: A program to calculate the number of prime numbers in a given
- range using both Set and Vector containers
+ range using Set and Vector containers as well as segmented, wheel and 
+ parallel sieves
  File: Sieve.cpp
  
  ***************************************************/
 
 //Includes
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory_resource>
 #include <set>
+#include <thread>
 #include <vector>
+#include "BitKernels.hpp"
+#include "PrimeBitmap.hpp"
 #include "Timer.hpp"
+#include "TscClock.hpp"
+#include "Wheel.hpp"
+
+//Build with -DTRACE_REGIONS to time the regions marked with TRACE_REGION 
+//(see Trace.hpp and runTrace); otherwise they compile to nothing, so the 
+//timed implementations do no extra work.
+#ifdef TRACE_REGIONS
+#include "Trace.hpp"
+#endif
+#ifndef TRACE_REGION
+#define TRACE_REGION(name)
+#endif
+
+//Number of integers sieved per window by the segmented sieve. One byte per
+//integer, so a window fits in a 32 KiB L1 data cache.
+const unsigned SEGMENT_SIZE = 32768;
+
+//Number of integers handed to a thread at a time by the parallel sieve. 
+//Each chunk is sieved window by window, so the starting multiples of the base
+//primes only have to be computed once per chunk.
+const unsigned CHUNK_SIZE = 64 * SEGMENT_SIZE;
 
 //Sieve Method Headers
 std::set<unsigned>
 sieveSet(unsigned N);
+std::pmr::set<unsigned>
+sieveSetPooled(unsigned N, std::pmr::memory_resource* pool);
 std::set<unsigned>
 sieveVector(unsigned N);
+unsigned long
+sieveSegmented(unsigned N);
+std::vector<unsigned char>
+sieveWheel(unsigned N);
+unsigned long
+countPrimes(unsigned N);
+template<typename Callback>
+void
+forEachPrime(unsigned N, Callback visit);
+unsigned long
+sieveParallel(unsigned N, unsigned threads);
+std::vector<uint16_t>
+sieveLinear(unsigned N, std::vector<unsigned>& primes);
+std::vector<unsigned>
+factorize(unsigned x, const std::vector<uint16_t>& spf);
+int
+runFactor(int argc, char* argv[]);
+template<typename Stopwatch>
+bool
+runImplementation(const std::string& implementation, unsigned N, 
+                  unsigned threads, Stopwatch& timer, unsigned long& count);
+int
+runPerf(int argc, char* argv[]);
+int
+runTrace(int argc, char* argv[]);
+int
+runBench(int argc, char* argv[]);
+std::vector<std::string>
+splitList(const std::string& list);
+std::string
+withCommas(unsigned long n);
+void
+benchmarkKernels(unsigned N);
+int
+runBitmap(int argc, char* argv[]);
+int
+runWindow(int argc, char* argv[]);
+bool
+checkWindows(std::ostream& out);
+std::vector<unsigned>
+basePrimes(unsigned long long N);
+unsigned long
+sieveRange(unsigned long long low, unsigned long long high,
+           const std::vector<unsigned>& primes);
+template<typename Callback>
+void
+forEachPrimeInRange(unsigned long long low, unsigned long long high,
+                    const std::vector<unsigned>& primes, Callback visit);
+std::vector<unsigned long long>
+firstMultiples(unsigned long long low, const std::vector<unsigned>& primes);
+void
+crossOffWindow(std::vector<unsigned char>& window, unsigned long long low,
+               unsigned long long last, const std::vector<unsigned>& primes,
+               std::vector<unsigned long long>& next);
 
+//Left out when Sieve.cpp is linked into another program, such as the
+//benchmark suite in bench/
+#ifndef SIEVE_NO_MAIN
 /*
 *Main method driver to run Set implementation or Vector implementation
-*Takes arguments implementation ("set" or "vector") and n (range of prime
-*values)
+*Takes arguments implementation ("set", "pooled", "vector", "segmented", 
+*"wheel", "stream", "linear", "parallel", "scaling" or "kernels") and n 
+*(range of prime values), optionally preceded by "-j <threads>" for the 
+*parallel implementation
+*Commands "build", "pi", "count" and "list" work on a saved bitmap instead
+*(see runBitmap), "window <L> <R> [list]" sieves only [L, R] (see 
+*runWindow), "factor <N> <x>..." factors each x <= N (see runFactor) and 
+*"--bench" times several implementations (see runBench), 
+*"perf <implementation> <N>" reads hardware counters (see runPerf), 
+*"trace <implementation> <N> <file>" dumps its timing regions in a build 
+*with -DTRACE_REGIONS (see runTrace), 
+*"clocks" reports the overhead of each clock usable with Timer and "test"
+*checks the windowed sieve against sieveVector (see checkWindows)
 */
 int main(int argc, char* argv[]){
-    //Must take 3 arguments (including program name)
-    if(argc != 3){
-        std::cerr << "Usage: " << argv[0] << " <implementation> <N>" 
-        << std::endl;
+    if (argc > 1){
+        std::string command (argv[1]);
+        if (command == "build" || command == "pi" || command == "count" ||
+            command == "list"){
+            return runBitmap(argc, argv);
+        }
+        if (command == "window"){
+            return runWindow(argc, argv);
+        }
+        if (command == "factor"){
+            return runFactor(argc, argv);
+        }
+        if (command == "perf"){
+            return runPerf(argc, argv);
+        }
+        if (command == "trace"){
+            return runTrace(argc, argv);
+        }
+        if (command == "clocks"){
+            //Calibrates TscClock and reports every clock's call overhead
+            return reportClocks(std::cout) ? 0 : EXIT_FAILURE;
+        }
+        if (command == "test"){
+            return checkWindows(std::cout) ? 0 : EXIT_FAILURE;
+        }
+        if (command == "--bench"){
+            return runBench(argc, argv);
+        }
+    }
+
+    //Must take 3 arguments (including program name), or 5 with -j
+    bool hasThreads = argc == 5 && std::string(argv[1]) == "-j";
+    if(argc != 3 && !hasThreads){
+        std::cerr << "Usage: " << argv[0] << " [-j <threads>] <implementation>"
+        << " <N>" << std::endl;
         exit(EXIT_FAILURE);
     }
 
     //Creates Timer object
     Timer timer = Timer();
 
+    //Defaults to one thread per hardware thread
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    if (hasThreads){
+        threads = std::max(1ul, stoul (std::string(argv[2])));
+    }
+
     //Convert arguments to string and unsigned
-    std::string implementation (argv[1]);
-    std::string arg2 (argv[2]);
+    int arg = hasThreads ? 3 : 1;
+    std::string implementation (argv[arg]);
+    std::string arg2 (argv[arg + 1]);
     unsigned N = stoul (arg2);
     
     //Runs implementation specified in argument
-    std::set<unsigned> primes;
-    if (implementation == "set"){
+    unsigned long count = 0;
+    if (implementation == "kernels"){
+        benchmarkKernels(N);
         timer.start();
-        primes = sieveSet(N);
+        count = countPrimes(N);
         timer.stop();
     }
-    else if (implementation == "vector"){
-        timer.start();
-        primes = sieveVector(N);
-        timer.stop();
+    else if (implementation == "scaling"){
+        //Reports the parallel sieve's time and speedup for 1 to threads
+        double baseMs = 0;
+        std::cout << "threads  time (ms)   speedup" << std::endl;
+        for (unsigned t=1;t<=threads;++t){
+            timer.start();
+            count = sieveParallel(N, t);
+            timer.stop();
+            if (t == 1) baseMs = timer.getElapsedMs();
+            std::cout << std::left << std::setw(9) << t << std::setw(12) 
+            << timer.getElapsedMs() << baseMs / timer.getElapsedMs() 
+            << std::endl;
+        }
     }
-    else{
+    else if (!runImplementation(implementation, N, threads, timer, count)){
         std::cerr << "Unknown argument: " << implementation << " in " << 
         argv[0] << std::endl;
         exit(EXIT_FAILURE);
     }
 
     //Outputs count of prime numbers as well as implementation used
-    std::cout << "Pi[" << N << "] = " << primes.size() << " (using a " <<
+    std::cout << "Pi[" << N << "] = " << count << " (using a " <<
     implementation << ")" << std::endl;
     std::cout << "Time: " << timer.getElapsedMs() << " ms" << std::endl;
 }
+#endif
 
 // Return the set of primes between 2 and N.
 // Use a set to implement the sieve.
@@ -88,27 +240,81 @@ sieveSet (unsigned N){
     return primes;
 }
 
+// Return the set of primes between 2 and N.
+// Same sieve as sieveSet, but every node comes from pool instead of its own
+//   heap allocation, and composites are found by walking an iterator 
+//   forward from the last one erased rather than searching down from the 
+//   root. The next multiple of a small prime is only a few survivors 
+//   ahead, so this replaces an O(log N) search with a step or two. Once a
+//   prime's multiples are more than WALK_LIMIT survivors apart, the rest
+//   of them are found with lower_bound.
+std::pmr::set<unsigned>
+sieveSetPooled (unsigned N, std::pmr::memory_resource* pool){
+    //Survivors to step over before searching from the root instead
+    const unsigned WALK_LIMIT = 8;
+
+    //Fills set primes with unsigned ints from 2 to N
+    std::pmr::set<unsigned> primes(pool);
+    for (unsigned i=2;i<=N;++i){ //Complexity: O(N)
+        primes.insert(primes.end(), i); //Complexity: O(1) with hint
+    }
+
+    auto it = primes.begin();
+    while (it != primes.end()){ //Complexity: O(N)
+        auto pos = std::next(it);
+        unsigned val = *it + *it;
+        //Multiples of this prime are too far apart for walking to pay
+        bool search = false;
+        while (val <= N){ //Complexity: O(log N)
+            unsigned steps = 0;
+            while (!search && pos != primes.end() && *pos < val && 
+                   steps < WALK_LIMIT){
+                ++pos;
+                ++steps;
+            }
+            if (pos != primes.end() && *pos < val){
+                search = true;
+                pos = primes.lower_bound(val); //Complexity: O(log N)
+            }
+            if (pos != primes.end() && *pos == val){
+                pos = primes.erase(pos); //Complexity: O(1) amortized
+            }
+            val += *it;
+        }
+        ++it;
+    }
+    return primes;
+}
+
 // Return the set of primes between 2 and N.
 // Use a vector to implement the sieve.
 // After filtering out the composites, put the primes in a set
 //   to return to the caller. 
 std::set<unsigned>
 sieveVector (unsigned N){
+    TRACE_REGION ("sieveVector");
     //Fills vector primes wth unsigned ints from 2 to N
     std::vector<bool> primesVector;
-    for (unsigned i=2;i<=N;++i){ //Complexity: O(N)
-        primesVector.push_back(true); //Complexity O(1)
+    {
+        TRACE_REGION ("fill");
+        for (unsigned i=2;i<=N;++i){ //Complexity: O(N)
+            primesVector.push_back(true); //Complexity O(1)
+        }
     }
 
     //Sets all multiples to false
-    for (unsigned i=2;i<=N;++i){ //Complexity: O(N)
-        if (!primesVector[i-2]) continue;
-        for (unsigned j=i+i;j<=N;j+=i){ //Complexity: O(log N)
-            primesVector[j-2] = false; //Complexity: O(1)
+    {
+        TRACE_REGION ("cross off");
+        for (unsigned i=2;i<=N;++i){ //Complexity: O(N)
+            if (!primesVector[i-2]) continue;
+            for (unsigned j=i+i;j<=N;j+=i){ //Complexity: O(log N)
+                primesVector[j-2] = false; //Complexity: O(1)
+            }
         }
     }
 
     //Fills primes set with vector primes
+    TRACE_REGION ("build set");
     std::set<unsigned> primesSet;
     for (unsigned i=0;i<primesVector.size();++i){ //Complexity: O(N)
         if(primesVector[i]){
@@ -118,6 +324,851 @@ sieveVector (unsigned N){
     return primesSet;
 }
 
+// Run implementation on N, timing only the sieve itself with timer (a Timer
+// or PerfCounters), and store the number of primes in count. Returns false 
+// for an unknown name.
+template<typename Stopwatch>
+bool
+runImplementation (const std::string& implementation, unsigned N, 
+                   unsigned threads, Stopwatch& timer, unsigned long& count){
+    std::set<unsigned> primes;
+    count = 0;
+    if (implementation == "set"){
+        timer.start();
+        primes = sieveSet(N);
+        timer.stop();
+        count = primes.size();
+    }
+    else if (implementation == "pooled"){
+        //Owns every node, so it must outlive the set built in it
+        std::pmr::monotonic_buffer_resource pool;
+        timer.start();
+        std::pmr::set<unsigned> pooled = sieveSetPooled(N, &pool);
+        timer.stop();
+        count = pooled.size();
+    }
+    else if (implementation == "vector"){
+        timer.start();
+        primes = sieveVector(N);
+        timer.stop();
+        count = primes.size();
+    }
+    else if (implementation == "segmented"){
+        timer.start();
+        count = sieveSegmented(N);
+        timer.stop();
+    }
+    else if (implementation == "wheel"){
+        timer.start();
+        count = countPrimes(N);
+        timer.stop();
+    }
+    else if (implementation == "stream"){
+        timer.start();
+        forEachPrime(N, [&count](unsigned){ ++count; });
+        timer.stop();
+    }
+    else if (implementation == "parallel"){
+        timer.start();
+        count = sieveParallel(N, threads);
+        timer.stop();
+    }
+    else if (implementation == "linear"){
+        std::vector<unsigned> linearPrimes;
+        timer.start();
+        std::vector<uint16_t> spf = sieveLinear(N, linearPrimes);
+        timer.stop();
+        count = linearPrimes.size();
+    }
+    else{
+        return false;
+    }
+    return true;
+}
+
+/*
+*Runs one implementation under PerfCounters instead of Timer:
+*  perf <implementation> <N>
+*Prints cycles, instructions, L1d and LLC misses and branch misses over
+*every thread of the run, or just the wall time if the counters are 
+*unavailable (for example when the kernel's perf_event_paranoid setting is 
+*too strict). Counts the kernel multiplexed are scaled and marked.
+*/
+int
+runPerf (int argc, char* argv[]){
+    if (argc != 4){
+        std::cerr << "Usage: " << argv[0] << " perf <implementation> <N>" 
+        << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::string implementation (argv[2]);
+    unsigned N = stoul (std::string(argv[3]));
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    PerfCounters counters;
+    unsigned long count = 0;
+    if (!runImplementation(implementation, N, threads, counters, count)){
+        std::cerr << "Unknown implementation: " << implementation 
+        << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::cout << "Pi[" << N << "] = " << count << " (using a " <<
+    implementation << ")" << std::endl;
+    std::cout << "Time: " << counters.getElapsedMs() << " ms" << std::endl;
+    if (counters.isWallTimeOnly()){
+        std::cout << "Hardware counters unavailable, wall time only" 
+        << std::endl;
+        return 0;
+    }
+    for (int e=0;e<PerfCounters::NUM_EVENTS;++e){
+        PerfCounters::Event event = static_cast<PerfCounters::Event>(e);
+        std::cout << std::left << std::setw(15) 
+        << PerfCounters::getName(event) + ":";
+        if (counters.isAvailable(event)){
+            std::cout << counters.getCount(event);
+            if (counters.getCoverage(event) < 1){
+                std::cout << " (scaled, counted " << 
+                (int) (100 * counters.getCoverage(event) + 0.5) << 
+                "% of the time)";
+            }
+            std::cout << std::endl;
+        }
+        else{
+            std::cout << "unavailable" << std::endl;
+        }
+    }
+    //Instructions per cycle, when both were counted
+    if (counters.isAvailable(PerfCounters::CYCLES) && 
+        counters.isAvailable(PerfCounters::INSTRUCTIONS) &&
+        counters.getCount(PerfCounters::CYCLES) > 0){
+        std::cout << std::setw(15) << "IPC:" << 
+        (double) counters.getCount(PerfCounters::INSTRUCTIONS) / 
+        counters.getCount(PerfCounters::CYCLES) << std::endl;
+    }
+    return 0;
+}
+
+/*
+*Runs one implementation and reports the TRACE_REGION regions it entered:
+*  trace <implementation> <N> <file>
+*Prints the per-thread region tree with count, total, min and max time and
+*writes every region as a Chrome trace event to file. Only a build with 
+*-DTRACE_REGIONS records regions; any other build says so and fails.
+*/
+int
+runTrace (int argc, char* argv[]){
+#ifndef TRACE_REGIONS
+    (void) argc;
+    std::cerr << argv[0] << " was built without -DTRACE_REGIONS, so it has "
+    << "no timing regions to trace" << std::endl;
+    exit(EXIT_FAILURE);
+#else
+    if (argc != 5){
+        std::cerr << "Usage: " << argv[0] << " trace <implementation> <N> "
+        << "<file>" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::string implementation (argv[2]);
+    unsigned N = stoul (std::string(argv[3]));
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    Timer timer = Timer();
+    unsigned long count = 0;
+    if (!runImplementation(implementation, N, threads, timer, count)){
+        std::cerr << "Unknown implementation: " << implementation 
+        << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::ofstream file (argv[4]);
+    if (!file){
+        std::cerr << "Could not write " << argv[4] << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::cout << "Pi[" << N << "] = " << count << " (using a " <<
+    implementation << ")" << std::endl;
+    std::cout << "Time: " << timer.getElapsedMs() << " ms" << std::endl;
+    RegionRegistry::instance().writeSummary(std::cout);
+    RegionRegistry::instance().writeChromeTrace(file);
+    return 0;
+#endif
+}
+
+//Splits a comma separated argument such as "vector,wheel" into its parts
+std::vector<std::string>
+splitList (const std::string& list){
+    std::vector<std::string> parts;
+    std::string::size_type begin = 0;
+    while (begin <= list.size()){
+        std::string::size_type end = list.find(',', begin);
+        if (end == std::string::npos) end = list.size();
+        if (end > begin) parts.push_back(list.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return parts;
+}
+
+//Formats n with thousands separators, as in the table at the end of the file
+std::string
+withCommas (unsigned long n){
+    std::string digits = std::to_string(n);
+    std::string formatted;
+    for (unsigned i=0;i<digits.size();++i){
+        if (i > 0 && (digits.size() - i) % 3 == 0) formatted += ',';
+        formatted += digits[i];
+    }
+    return formatted;
+}
+
+/*
+*Times every implementation over every N with warm-up runs and repetitions:
+*  --bench [--impl a,b,...] [--n N1,N2,...] [--reps K] [--warmup W]
+*          [--format table|csv|json] [-j <threads>]
+*Reports min, median, mean and standard deviation in ms and throughput in
+*integers/s (N over the median time). The table format matches the table at
+*the end of this file, using the median.
+*/
+int
+runBench (int argc, char* argv[]){
+    std::vector<std::string> implementations = 
+        splitList("vector,segmented,wheel,parallel");
+    std::vector<std::string> sizes = 
+        splitList("10000000,20000000,40000000");
+    unsigned reps = 5;
+    unsigned warmup = 1;
+    std::string format = "table";
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    //Every option takes one value
+    for (int i=2;i<argc;i+=2){
+        std::string option (argv[i]);
+        if (i + 1 >= argc){
+            std::cerr << "Missing value for " << option << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::string value (argv[i + 1]);
+        if (option == "--impl") implementations = splitList(value);
+        else if (option == "--n") sizes = splitList(value);
+        else if (option == "--reps") reps = std::max(1ul, stoul (value));
+        else if (option == "--warmup") warmup = stoul (value);
+        else if (option == "--format") format = value;
+        else if (option == "-j") threads = std::max(1ul, stoul (value));
+        else{
+            std::cerr << "Usage: " << argv[0] << " --bench [--impl a,b,...] "
+            << "[--n N1,N2,...] [--reps K] [--warmup W] "
+            << "[--format table|csv|json] [-j <threads>]" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (format != "table" && format != "csv" && format != "json"){
+        std::cerr << "Unknown format: " << format << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    struct Result {
+        std::string implementation;
+        unsigned N;
+        unsigned long count;
+        double min, median, mean, stddev, throughput;
+    };
+    std::vector<Result> results;
+    Timer timer = Timer();
+    for (const std::string& implementation : implementations){
+        for (const std::string& size : sizes){
+            unsigned N = stoul (size);
+            unsigned long count = 0;
+            for (unsigned w=0;w<warmup;++w){
+                runImplementation(implementation, N, threads, timer, count);
+            }
+            std::vector<double> times;
+            for (unsigned r=0;r<reps;++r){
+                if (!runImplementation(implementation, N, threads, timer,
+                                       count)){
+                    std::cerr << "Unknown implementation: " << implementation
+                    << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                times.push_back(timer.getElapsedMs());
+            }
+
+            std::sort(times.begin(), times.end());
+            Result result {implementation, N, count, times.front(), 0, 0, 0,
+                           0};
+            result.median = reps % 2 ? times[reps / 2] : 
+                (times[reps / 2 - 1] + times[reps / 2]) / 2;
+            for (double t : times) result.mean += t / reps;
+            for (double t : times){
+                result.stddev += (t - result.mean) * (t - result.mean);
+            }
+            result.stddev = reps > 1 ? std::sqrt(result.stddev / (reps - 1)) 
+                : 0;
+            result.throughput = N / (result.median / 1000);
+            results.push_back(result);
+        }
+    }
+
+    if (format == "csv"){
+        std::cout << "implementation,N,pi,reps,min_ms,median_ms,mean_ms,"
+        << "stddev_ms,integers_per_s" << std::endl;
+        for (const Result& r : results){
+            std::cout << r.implementation << ',' << r.N << ',' << r.count 
+            << ',' << reps << ',' << r.min << ',' << r.median << ',' << r.mean
+            << ',' << r.stddev << ',' << r.throughput << std::endl;
+        }
+    }
+    else if (format == "json"){
+        std::cout << "[" << std::endl;
+        for (unsigned i=0;i<results.size();++i){
+            const Result& r = results[i];
+            std::cout << "  {\"implementation\": \"" << r.implementation 
+            << "\", \"N\": " << r.N << ", \"pi\": " << r.count 
+            << ", \"reps\": " << reps << ", \"min_ms\": " << r.min 
+            << ", \"median_ms\": " << r.median << ", \"mean_ms\": " 
+            << r.mean << ", \"stddev_ms\": " << r.stddev 
+            << ", \"integers_per_s\": " << r.throughput << "}" 
+            << (i + 1 < results.size() ? "," : "") << std::endl;
+        }
+        std::cout << "]" << std::endl;
+    }
+    else{
+        //One row per implementation, one column per N
+        std::cout << std::left << std::setw(11) << "N";
+        for (unsigned j=0;j<sizes.size();++j){
+            std::cout << std::setw(j + 1 < sizes.size() ? 14 : 0) 
+            << withCommas(stoul (sizes[j]));
+        }
+        std::cout << std::endl << std::string(11 + 14 * sizes.size(), '=')
+        << std::endl << std::fixed << std::setprecision(2);
+        for (unsigned i=0;i<results.size();i+=sizes.size()){
+            std::cout << std::setw(11) << results[i].implementation;
+            for (unsigned j=0;j<sizes.size();++j){
+                std::cout << std::setw(j + 1 < sizes.size() ? 14 : 0) 
+                << results[i + j].median;
+            }
+            std::cout << std::endl;
+        }
+    }
+    return 0;
+}
+
+// Time the scalar and AVX2 versions of the pre-sieve and popcount kernels
+// on a wheel bitmap for N, checking that both produce the same result.
+void
+benchmarkKernels (unsigned N){
+    unsigned long bytes = N / 30 + 1;
+    std::vector<unsigned char> scalar(bytes);
+    std::vector<unsigned char> simd(bytes);
+    Timer timer = Timer();
+    const int runs = 10;
+
+    //Best of several runs, since each kernel takes well under a millisecond
+    auto best = [&](auto kernel){
+        double ms = 0;
+        for (int r=0;r<runs;++r){
+            timer.start();
+            kernel();
+            timer.stop();
+            if (r == 0 || timer.getElapsedMs() < ms) ms = timer.getElapsedMs();
+        }
+        return ms;
+    };
+
+    unsigned long long scalarCount = 0;
+    unsigned long long simdCount = 0;
+    double presieveScalar = best([&](){
+        BitKernels::presieveScalar(scalar.data(), bytes); });
+    double popcountScalar = best([&](){
+        scalarCount = BitKernels::popcountScalar(scalar.data(), bytes); });
+    double presieveSimd = presieveScalar;
+    double popcountSimd = popcountScalar;
+    simdCount = scalarCount;
+    simd = scalar;
+#ifdef BIT_KERNELS_X86
+    if (BitKernels::hasAvx2()){
+        presieveSimd = best([&](){
+            BitKernels::presieveAvx2(simd.data(), bytes); });
+        popcountSimd = best([&](){
+            simdCount = BitKernels::popcountAvx2(simd.data(), bytes); });
+    }
+#endif
+    if (simd != scalar || simdCount != scalarCount){
+        std::cerr << "Scalar and SIMD kernels disagree" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::cout << "kernel     scalar (ms)  " << 
+    (BitKernels::hasAvx2() ? "avx2" : "none") << " (ms)" << std::endl;
+    std::cout << std::left << std::setw(11) << "presieve" << std::setw(13) 
+    << presieveScalar << presieveSimd << std::endl;
+    std::cout << std::setw(11) << "popcount" << std::setw(13) 
+    << popcountScalar << popcountSimd << std::endl;
+}
+
+/*
+*Runs a command against a saved PrimeBitmap file:
+*  build <N> <file>        sieve [2, N] once and save it to file
+*  pi <file> <x>...        Pi[x] for each x
+*  count <file> <a> <b>    number of primes in [a, b]
+*  list <file> <a> <b>     print the primes in [a, b], one per line
+*/
+int
+runBitmap (int argc, char* argv[]){
+    std::string command (argv[1]);
+    bool valid = (command == "build" && argc == 4) ||
+                 (command == "pi" && argc >= 4) ||
+                 ((command == "count" || command == "list") && argc == 5);
+    if (!valid){
+        std::cerr << "Usage: " << argv[0] << " build <N> <file>\n"
+        << "       " << argv[0] << " pi <file> <x>...\n"
+        << "       " << argv[0] << " count|list <file> <a> <b>" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Timer timer = Timer();
+    if (command == "build"){
+        unsigned N = stoul (std::string(argv[2]));
+        timer.start();
+        bool written = PrimeBitmap::write(argv[3], N, sieveWheel(N));
+        timer.stop();
+        if (!written){
+            std::cerr << "Could not write " << argv[3] << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::cout << "Built bitmap for N = " << N << " in " << argv[3]
+        << std::endl;
+        std::cout << "Time: " << timer.getElapsedMs() << " ms" << std::endl;
+        return 0;
+    }
+
+    PrimeBitmap bitmap (argv[2]);
+    if (!bitmap.isOpen()){
+        std::cerr << "Could not read bitmap " << argv[2] << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    //Every queried value must be covered by the bitmap
+    std::vector<unsigned long long> values;
+    for (int i=3;i<argc;++i){
+        values.push_back(stoull (std::string(argv[i])));
+        if (values.back() > bitmap.limit()){
+            std::cerr << values.back() << " is past the bitmap limit " <<
+            bitmap.limit() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (command == "pi"){
+        for (unsigned long long x : values){
+            std::cout << "Pi[" << x << "] = " << bitmap.pi(x) << std::endl;
+        }
+    }
+    else if (command == "count"){
+        std::cout << "Primes in [" << values[0] << ", " << values[1] << 
+        "] = " << bitmap.count(values[0], values[1]) << std::endl;
+    }
+    else{
+        bitmap.forEach(values[0], values[1], [](unsigned long long p){
+            std::cout << p << '\n';
+        });
+    }
+    return 0;
+}
+
+/*
+*Sieves only the window [L, R], which may lie far above 2^32:
+*  window <L> <R>          number of primes in [L, R]
+*  window <L> <R> list     print the primes in [L, R], one per line
+*/
+int
+runWindow (int argc, char* argv[]){
+    if (argc != 4 && !(argc == 5 && std::string(argv[4]) == "list")){
+        std::cerr << "Usage: " << argv[0] << " window <L> <R> [list]" 
+        << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    unsigned long long L = stoull (std::string(argv[2]));
+    unsigned long long R = stoull (std::string(argv[3]));
+    //Keeps every multiple the sieve steps to representable in 64 bits
+    if (R >= (1ull << 63)){
+        std::cerr << "R must be below 2^63" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Timer timer = Timer();
+    timer.start();
+    std::vector<unsigned> primes = basePrimes(R);
+    unsigned long count = 0;
+    if (argc == 5){
+        forEachPrimeInRange(L, R, primes, [&count](unsigned long long p){
+            std::cout << p << '\n';
+            ++count;
+        });
+    }
+    else if (std::max(L, 2ull) <= R){
+        count = sieveRange(std::max(L, 2ull), R, primes);
+    }
+    timer.stop();
+
+    std::cout << "Primes in [" << L << ", " << R << "] = " << count <<
+    std::endl;
+    std::cout << "Time: " << timer.getElapsedMs() << " ms" << std::endl;
+    return 0;
+}
+
+// Check sieveRange and forEachPrimeInRange against sieveVector on every
+// window [L, R] with L, R <= 300, including the empty ones and the ones
+// lying entirely below 2. Reports each mismatch to out and returns true
+// if there were none.
+bool
+checkWindows (std::ostream& out){
+    const unsigned MAX = 300;
+    std::set<unsigned> expected = sieveVector(MAX);
+    std::vector<unsigned> primes = basePrimes(MAX);
+    unsigned failures = 0;
+    for (unsigned long long L=0;L<=MAX;++L){
+        for (unsigned long long R=0;R<=MAX;++R){
+            unsigned long want = 0;
+            for (unsigned p : expected){
+                if (p >= L && p <= R) ++want;
+            }
+            unsigned long counted = sieveRange(std::max(L, 2ull), R, primes);
+            unsigned long listed = 0;
+            forEachPrimeInRange(L, R, primes, [&listed](unsigned long long){
+                ++listed;
+            });
+            if (counted != want || listed != want){
+                out << "window [" << L << ", " << R << "]: expected " << 
+                want << ", sieveRange " << counted << 
+                ", forEachPrimeInRange " << listed << std::endl;
+                ++failures;
+            }
+        }
+    }
+    out << (failures == 0 ? "All windows passed" : "Some windows failed") 
+    << std::endl;
+    return failures == 0;
+}
+
+// Return the smallest prime factor table for [0, N] and put the primes 
+// between 2 and N in primes, in increasing order.
+// Uses the linear (Euler) sieve: every composite x is written exactly once,
+//   as p * i where p = spf(x) <= spf(i). Only odd x are stored (spf of an 
+//   even x is 2), at index x/2. A composite's smallest prime factor is at 
+//   most sqrt(N) < 65536, so it fits in 16 bits, and 0 marks a prime. That 
+//   is one byte per integer rather than 4 for a plain uint32 table.
+std::vector<uint16_t>
+sieveLinear (unsigned N, std::vector<unsigned>& primes){
+    primes.clear();
+    std::vector<uint16_t> spf(N / 2 + 1, 0);
+    if (N < 2) return spf;
+    primes.push_back(2);
+
+    for (unsigned long long i=3;i<=N;i+=2){ //Complexity: O(N)
+        unsigned long long smallest = spf[i / 2] == 0 ? i : spf[i / 2];
+        if (smallest == i) primes.push_back(i);
+
+        //Writes p * i for each odd prime p up to spf(i)
+        for (unsigned k=1;k<primes.size();++k){ //Complexity: O(1) amortized
+            unsigned long long p = primes[k];
+            if (p > smallest || p * i > N) break;
+            spf[p * i / 2] = p;
+        }
+    }
+    return spf;
+}
+
+// Return the prime factors of x in increasing order, with repeats.
+// spf must come from sieveLinear(N) with x <= N. Each step divides x by at
+//   least 2, so this takes O(log x).
+std::vector<unsigned>
+factorize (unsigned x, const std::vector<uint16_t>& spf){
+    std::vector<unsigned> factors;
+    while (x > 1 && x % 2 == 0){
+        factors.push_back(2);
+        x /= 2;
+    }
+    while (x > 1){ //Complexity: O(log x)
+        unsigned p = spf[x / 2] == 0 ? x : spf[x / 2];
+        factors.push_back(p);
+        x /= p;
+    }
+    return factors;
+}
+
+/*
+*Factors integers with the linear sieve's smallest prime factor table:
+*  factor <N> <x>...       print the prime factors of each x <= N
+*/
+int
+runFactor (int argc, char* argv[]){
+    if (argc < 4){
+        std::cerr << "Usage: " << argv[0] << " factor <N> <x>..." 
+        << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    unsigned N = stoul (std::string(argv[2]));
+    std::vector<unsigned> primes;
+    std::vector<uint16_t> spf = sieveLinear(N, primes);
+    for (int i=3;i<argc;++i){
+        unsigned long x = stoul (std::string(argv[i]));
+        if (x > N){
+            std::cerr << x << " is larger than N = " << N << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::cout << x << " =";
+        for (unsigned p : factorize(x, spf)){
+            std::cout << " " << p;
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+// Return the primes between 2 and floor(sqrt(N)).
+// These are the only primes needed to cross off every composite up to N.
+std::vector<unsigned>
+basePrimes (unsigned long long N){
+    //Integer square root, corrected for floating point rounding
+    unsigned long long root = std::sqrt((double) N);
+    while (root * root > N) --root;
+    while ((root + 1) * (root + 1) <= N) ++root;
+
+    //Plain sieve over [0, root], at most 65536 entries for a 32 bit N and
+    //about 3 billion for the largest window
+    std::vector<bool> composite(root + 1, false);
+    std::vector<unsigned> primes;
+    for (unsigned long long i=2;i<=root;++i){ //Complexity: O(sqrt N)
+        if (composite[i]) continue;
+        primes.push_back(i);
+        for (unsigned long long j=i*i;j<=root;j+=i){ //Complexity: O(log log N)
+            composite[j] = true;
+        }
+    }
+    return primes;
+}
+
+// Return the number of primes between 2 and N.
+// Sieve [2, N] one SEGMENT_SIZE window at a time using the base primes up
+//   to sqrt(N), so memory use depends on sqrt(N) rather than N. Only the
+//   count is returned since a set of every prime would be O(N) again.
+unsigned long
+sieveSegmented (unsigned N){
+    if (N < 2) return 0;
+    return sieveRange(2, N, basePrimes(N));
+}
+
+// Return the number of primes in [low, high], where low >= 2 (0 if the
+//   range is empty). primes must hold every prime up to sqrt(high). 
+//   [low, high] is sieved one SEGMENT_SIZE window at a time, so only one 
+//   window is ever in memory.
+unsigned long
+sieveRange (unsigned long long low, unsigned long long high,
+            const std::vector<unsigned>& primes){
+    if (low > high) return 0;
+    std::vector<unsigned long long> next = firstMultiples(low, primes);
+    std::vector<unsigned char> window(SEGMENT_SIZE);
+    unsigned long count = 0;
+    while (true){ //Complexity: O(N/S)
+        unsigned long long last = std::min<unsigned long long>
+            (low + SEGMENT_SIZE - 1, high);
+        crossOffWindow(window, low, last, primes, next);
+
+        //Counts the surviving integers in the window
+        for (unsigned long long i=0;i<=last-low;++i){ //Complexity: O(S)
+            count += window[i];
+        }
+        if (last == high) break;
+        low = last + 1;
+    }
+    return count;
+}
+
+// Call visit(p) for every prime p in [low, high] in increasing order.
+// Same windows as sieveRange, but each survivor is visited instead of 
+//   counted, so memory stays proportional to SEGMENT_SIZE and not to high.
+template<typename Callback>
+void
+forEachPrimeInRange (unsigned long long low, unsigned long long high,
+                     const std::vector<unsigned>& primes, Callback visit){
+    low = std::max(low, 2ull);
+    if (low > high) return;
+    std::vector<unsigned long long> next = firstMultiples(low, primes);
+    std::vector<unsigned char> window(SEGMENT_SIZE);
+    while (true){ //Complexity: O(N/S)
+        unsigned long long last = std::min<unsigned long long>
+            (low + SEGMENT_SIZE - 1, high);
+        crossOffWindow(window, low, last, primes, next);
+        for (unsigned long long i=0;i<=last-low;++i){ //Complexity: O(S)
+            if (window[i]) visit(low + i);
+        }
+        if (last == high) break;
+        low = last + 1;
+    }
+}
+
+// Return the first multiple of each base prime to cross off in [low, ...).
+// Starts at p*p at the earliest since smaller multiples have a smaller prime
+//   factor. Kept as 64 bit so that stepping past 2^32-1 cannot wrap around.
+std::vector<unsigned long long>
+firstMultiples (unsigned long long low, const std::vector<unsigned>& primes){
+    std::vector<unsigned long long> next;
+    next.reserve(primes.size());
+    for (unsigned p : primes){
+        unsigned long long first = low + (p - low % p) % p;
+        next.push_back(std::max(first, (unsigned long long) p * p));
+    }
+    return next;
+}
+
+// Reset window to hold [low, last] and cross off the multiples of each base
+// prime in it. next[k] is the next multiple of primes[k] to cross off and is
+// advanced past last for the following window.
+void
+crossOffWindow (std::vector<unsigned char>& window, unsigned long long low,
+                unsigned long long last, const std::vector<unsigned>& primes,
+                std::vector<unsigned long long>& next){
+    std::fill(window.begin(), window.end(), 1);
+    for (unsigned k=0;k<primes.size();++k){ //Complexity: O(sqrt N)
+        unsigned long long j = next[k];
+        for (;j<=last;j+=primes[k]){ //Complexity: O(S/p)
+            window[j-low] = 0;
+        }
+        next[k] = j;
+    }
+}
+
+// Return the number of primes between 2 and N.
+// [2, N] is split into CHUNK_SIZE chunks that a pool of threads takes from a
+//   shared counter. Every thread sieves its chunks with sieveRange against 
+//   the same read-only base primes and records each chunk's count, and the
+//   counts are added up once all threads have joined.
+unsigned long
+sieveParallel (unsigned N, unsigned threads){
+    if (N < 2) return 0;
+    const std::vector<unsigned> primes = basePrimes(N);
+
+    unsigned long chunks = (N - 2ul) / CHUNK_SIZE + 1;
+    std::vector<unsigned long> counts(chunks, 0);
+    std::atomic<unsigned long> nextChunk(0);
+
+    //Each worker keeps taking the next unsieved chunk until none are left
+    auto worker = [&](){
+        unsigned long c;
+        while ((c = nextChunk.fetch_add(1)) < chunks){
+            unsigned long long low = 2 + (unsigned long long) c * CHUNK_SIZE;
+            unsigned long long high = std::min<unsigned long long>
+                (low + CHUNK_SIZE - 1, N);
+            counts[c] = sieveRange(low, high, primes);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t=1;t<threads;++t){
+        pool.emplace_back(worker);
+    }
+    worker(); //The calling thread works too
+    for (std::thread& t : pool){
+        t.join();
+    }
+
+    unsigned long count = 0;
+    for (unsigned long c : counts){ //Complexity: O(N/C)
+        count += c;
+    }
+    return count;
+}
+
+// Return the primes between 7 and N as a mod 30 wheel bitmap.
+// One byte holds the 8 integers in each block of 30 that are not multiples 
+//   of 2, 3 or 5, so memory is N/30 bytes (3.75x smaller than a vector<bool>)
+//   and only multiples coprime to 30 are crossed off. Bits for integers > N
+//   are cleared and the bitmap is zero padded to a multiple of 8 bytes so it 
+//   can be read a 64 bit word at a time.
+std::vector<unsigned char>
+sieveWheel (unsigned N){
+    //Maps a residue mod 30 to its bit on the wheel
+    unsigned char bitOf[30] = {};
+    for (unsigned b=0;b<8;++b){
+        bitOf[WHEEL[b]] = 1 << b;
+    }
+
+    unsigned long bytes = N / 30 + 1;
+    std::vector<unsigned char> wheel((bytes + 7) / 8 * 8, 0);
+
+    //Stamps the multiples of 7 to 19 from precomputed patterns, then puts
+    //back 7 to 19 themselves, which all live in byte 0
+    BitKernels::presieve(wheel.data(), bytes);
+    for (unsigned p : BitKernels::PRESIEVE_PRIMES){
+        wheel[0] |= bitOf[p];
+    }
+    wheel[0] &= ~bitOf[1]; //1 is not prime
+
+    for (unsigned long i=0;900ull*i*i<=N;++i){ //Complexity: O(sqrt N)
+        for (unsigned b=0;b<8;++b){
+            unsigned long long p = 30ull * i + WHEEL[b];
+            if (p * p > N) break;
+            if (p <= 19 || !(wheel[i] & (1 << b))) continue;
+
+            //Multiples p*q with q coprime to 30 fall into 8 residue classes
+            //of q. Each class steps by 30p, which is exactly p bytes with
+            //the same bit every time.
+            for (unsigned c=0;c<8;++c){ //Complexity: O(N/p)
+                unsigned long long q = p - p % 30 + WHEEL[c];
+                if (q < p) q += 30;
+                unsigned long long m = p * q;
+                unsigned char mask = ~bitOf[m % 30];
+                for (unsigned long long j=m/30;j*30+WHEEL[0]<=N;j+=p){
+                    wheel[j] &= mask;
+                }
+            }
+        }
+    }
+
+    //Clears the bits in the last byte that stand for integers > N
+    for (unsigned b=0;b<8;++b){
+        if (30ull * (bytes - 1) + WHEEL[b] > N){
+            wheel[bytes-1] &= ~(1 << b);
+        }
+    }
+    return wheel;
+}
+
+// Return the number of primes between 2 and N.
+// Popcounts the wheel bitmap directly, so nothing but the N/30 byte bitmap
+//   is ever allocated.
+unsigned long
+countPrimes (unsigned N){
+    //2, 3 and 5 are not stored on the wheel
+    unsigned long count = (N >= 2) + (N >= 3) + (N >= 5);
+    if (N < 7) return count;
+
+    std::vector<unsigned char> wheel = sieveWheel(N);
+    return count + BitKernels::popcount(wheel.data(), wheel.size());
+}
+
+// Call visit(p) for every prime p between 2 and N in increasing order.
+// Walks the wheel bitmap directly, so no container of primes is built.
+template<typename Callback>
+void
+forEachPrime (unsigned N, Callback visit){
+    for (unsigned p : {2u, 3u, 5u}){
+        if (p <= N) visit(p);
+    }
+    if (N < 7) return;
+
+    std::vector<unsigned char> wheel = sieveWheel(N);
+    for (unsigned long i=0;i<wheel.size();++i){ //Complexity: O(N/30)
+        //Visits the set bits of the byte from lowest to highest
+        unsigned bits = wheel[i];
+        while (bits != 0){
+            unsigned b = std::countr_zero(bits);
+            visit((unsigned) (30 * i + WHEEL[b]));
+            bits &= bits - 1;
+        }
+    }
+}
+
 /*
 N       10,000,000    20,000,000   40,000,000
 =============================================
@@ -131,4 +1182,95 @@ Additionally,the set implementation must dereference iterators while vector
 moves through a range of integers. The complexity for the set implementation
 is O(N (log N)^2) and the complexity for the vector implementation is 
 O(N log n).
+
+"Sieve --bench --impl set,vector" regenerates this table from the median of
+several timed runs after a warm-up run, and "--format csv" or "--format json"
+adds min, mean, standard deviation and throughput for tracking regressions.
+
+The linear implementation also builds a smallest prime factor table so any
+x <= N can be factored in O(log x) (g++ -O2, different machine, median of 3):
+
+N          10,000,000    20,000,000    40,000,000
+=====================================================
+vector     189.94        408.37        831.02
+linear     51.42         104.98        210.84
+
+At N = 40,000,000 the vector implementation needs 5 MB of bits plus about
+94 MB of set nodes for the primes it returns. The linear implementation 
+needs 40 MB for the table (one 16 bit entry per odd integer) plus 9.7 MB for
+the primes as a vector of unsigned, and it is still 4x faster since each 
+composite is written once and nothing goes through a tree.
+
+The pooled implementation is the same set sieve with its nodes carved out of
+a std::pmr::monotonic_buffer_resource, and composites found by walking an
+iterator forward from the last erase instead of searching from the root 
+(g++ -O2, different machine, N = 10,000,000, mean of 2 runs):
+
+set                   22769
+pooled, find + erase  19347
+pooled, walking       17352
+vector                  332
+
+Pooling the nodes by itself takes 15% off the set: the tree is the same, 
+but its nodes sit next to each other and cost no malloc or free. Walking 
+takes a further 10% off, since the multiples of the small primes (which 
+are most of the erases) are only a few survivors apart, and it closes the
+gap to the vector from 69x to 52x. Almost all of the remaining time goes to
+the large primes, whose multiples are still found with an O(log N) search
+down the tree, where each level is a dependent pointer load that usually 
+misses in cache.
+
+The segmented and wheel implementations were timed separately (g++ -O2, 
+different machine), so they are compared against the vector implementation
+on that run:
+
+N          10,000,000    20,000,000   40,000,000
+================================================
+vector     207.96        415.69       817.61
+segmented  29.08         50.53        117.51
+wheel      6.48          14.59        26.90
+
+The segmented implementation only keeps the base primes up to sqrt(N) and a
+single SEGMENT_SIZE window in memory. Every window stays in L1 while it is
+being crossed off, where the vector implementation strides over all N bits
+for every prime and misses in cache once N is more than a few million.
+
+The wheel implementation stores 8 bits per 30 integers, so it needs 3.75x
+less memory than vector<bool> (1.33 MB instead of 5 MB at N = 40,000,000).
+Multiples of 2, 3 and 5 are never stored or crossed off, which cuts the
+number of marking stores by the same factor.
+
+The parallel implementation runs sieveRange on disjoint chunks of [2, N], so
+the only shared data is the read-only table of base primes and the only 
+synchronization is one atomic increment per CHUNK_SIZE integers. 
+"Sieve -j <threads> scaling <N>" prints its time and speedup over one thread
+for every thread count from 1 to <threads>. Compile with -pthread.
+
+Callers that only need Pi[N] should use countPrimes, and callers that need
+to look at each prime should use forEachPrime. Neither builds a set, so at
+N = 40,000,000 they skip the ~2.4 million red-black tree nodes the set and
+vector implementations allocate just to report primes.size().
+
+For many queries against the same limit, "Sieve build <N> <file>" saves the
+wheel bitmap with a rank entry every 512 bits. "pi", "count" and "list" then
+mmap that file instead of sieving again, and each Pi[x] is one rank lookup
+plus at most 8 popcounts.
+
+"Sieve window <L> <R>" reuses the same windows as the segmented sieve on
+[L, R] alone, with 64 bit bounds and base primes up to sqrt(R). Memory is the
+base primes plus one window, so [10^12, 10^12 + 10^8] needs about 78,000 base
+primes rather than a bitmap of 10^12 integers.
+
+The wheel sieve starts from a pre-sieve that stamps the multiples of 7 to 19
+from two repeating byte patterns (1001 and 323 bytes) instead of crossing 
+them off one at a time, and countPrimes popcounts 32 bytes per step. Both 
+kernels pick AVX2 at runtime when the CPU has it. "Sieve kernels <N>" times
+the scalar and AVX2 versions side by side on the N/30 byte bitmap:
+
+kernel     scalar (ms)  avx2 (ms)    (N = 40,000,000, g++ -O2)
+presieve   0.21         0.07
+popcount   0.56         0.07
+
+With the pre-sieve the wheel implementation at N = 40,000,000 went from 
+26.90 ms to about 19 ms on the same machine as the table above.
 */
\ No newline at end of file
@@ -5,6 +5,8 @@
   Assignment : -
   Description: A templated timer class for timing algorithms.
                { steady, system, high_resolution }_clock may be used. 
+               PerfCounters is used the same way and also reads hardware
+               performance counters on Linux.
 */   
 
 /************************************************************/
@@ -17,6 +19,15 @@
 // System includes
 
 #include <chrono>
+#include <cstdint>
+#include <string>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 /************************************************************/
 // Local includes
@@ -58,6 +69,14 @@ public:
     return elapsedMs;
   }
 
+  // Time of the last start () in ms since the clock's epoch
+  double
+  getStartMs () const
+  {
+    return std::chrono::duration
+      <double, std::milli> (m_start.time_since_epoch ()).count ();
+  }
+
 private:
 
   decltype (Clock::now ()) m_start;
@@ -66,6 +85,207 @@ private:
 
 /************************************************************/
 
+// Counts hardware events between start () and stop () with Linux
+// perf_event_open, alongside the wall time of a Timer. The calling thread is
+// counted along with every thread it starts after the PerfCounters is
+// constructed, so parallel implementations are counted in full. Counters
+// that cannot be opened (no permission, not Linux, running in a VM without a
+// PMU) are reported as unavailable and only the wall time is kept. When
+// there are more events than hardware counters the kernel takes turns with
+// them; each count is then scaled up from the time it was actually counted,
+// and getCoverage () says how much of the time that was.
+class PerfCounters
+{
+public:
+
+  enum Event
+  {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    NUM_EVENTS
+  };
+
+  PerfCounters ()
+  {
+    for (int e = 0; e < NUM_EVENTS; ++e)
+    {
+      m_fd[e] = open (static_cast<Event> (e));
+      m_count[e] = 0;
+      m_coverage[e] = 1;
+    }
+  }
+
+  PerfCounters (const PerfCounters&) = delete;
+
+  PerfCounters&
+  operator= (const PerfCounters&) = delete;
+
+  ~PerfCounters ()
+  {
+#ifdef __linux__
+    for (int e = 0; e < NUM_EVENTS; ++e)
+    {
+      if (m_fd[e] >= 0)
+      {
+        close (m_fd[e]);
+      }
+    }
+#endif
+  }
+
+  void
+  start ()
+  {
+#ifdef __linux__
+    for (int e = 0; e < NUM_EVENTS; ++e)
+    {
+      if (m_fd[e] >= 0)
+      {
+        ioctl (m_fd[e], PERF_EVENT_IOC_RESET, 0);
+        ioctl (m_fd[e], PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif
+    m_timer.start ();
+  }
+
+  void
+  stop ()
+  {
+    m_timer.stop ();
+#ifdef __linux__
+    for (int e = 0; e < NUM_EVENTS; ++e)
+    {
+      if (m_fd[e] >= 0)
+      {
+        ioctl (m_fd[e], PERF_EVENT_IOC_DISABLE, 0);
+        // value, time enabled, time running (see read_format)
+        uint64_t values[3] = {0, 0, 0};
+        if (read (m_fd[e], values, sizeof values) == sizeof values)
+        {
+          m_count[e] = values[0];
+          m_coverage[e] = 1;
+          if (values[2] > 0 && values[2] < values[1])
+          {
+            m_coverage[e] = (double) values[2] / values[1];
+            m_count[e] = (uint64_t) (values[0] / m_coverage[e]);
+          }
+        }
+      }
+    }
+#endif
+  }
+
+  double
+  getElapsedMs () const
+  {
+    return m_timer.getElapsedMs ();
+  }
+
+  // True if event was counted between the last start and stop
+  bool
+  isAvailable (Event event) const
+  {
+    return m_fd[event] >= 0;
+  }
+
+  // True if no counters could be opened and only wall time is measured
+  bool
+  isWallTimeOnly () const
+  {
+    for (int e = 0; e < NUM_EVENTS; ++e)
+    {
+      if (m_fd[e] >= 0)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The count for event, scaled up if it was only counted part of the time
+  uint64_t
+  getCount (Event event) const
+  {
+    return m_count[event];
+  }
+
+  // Fraction of the time event was actually counted: 1 unless the kernel
+  // had to multiplex it with the other events
+  double
+  getCoverage (Event event) const
+  {
+    return m_coverage[event];
+  }
+
+  static std::string
+  getName (Event event)
+  {
+    static const char* const names[NUM_EVENTS] = {
+      "cycles", "instructions", "L1d misses", "LLC misses", "branch misses"};
+    return names[event];
+  }
+
+private:
+
+  // Open a disabled counter for event on this thread and the threads it
+  // starts, or return -1
+  static int
+  open (Event event)
+  {
+#ifdef __linux__
+    perf_event_attr attr {};
+    attr.size = sizeof attr;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+      | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    switch (event)
+    {
+    case CYCLES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case INSTRUCTIONS:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case L1D_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = PERF_COUNT_HW_CACHE_L1D
+        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+      break;
+    case LLC_MISSES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CACHE_MISSES;
+      break;
+    default:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    }
+    return static_cast<int> (syscall (SYS_perf_event_open, &attr, 0, -1, -1,
+                                      0));
+#else
+    (void) event;
+    return -1;
+#endif
+  }
+
+  Timer<> m_timer;
+  int m_fd[NUM_EVENTS];
+  uint64_t m_count[NUM_EVENTS];
+  double m_coverage[NUM_EVENTS];
+};
+
+/************************************************************/
+
 #endif
 
 /************************************************************/
@@ -0,0 +1,290 @@
+/*
+  Filename   : Trace.hpp
+  Author     : Jaysen Hippensteel
+  Course     : Varies
+  Assignment : -
+  Description: Scoped, nested timing regions built on Timer.
+               TRACE_REGION ("name") times the rest of the enclosing scope.
+               Each thread aggregates count, total, min and max time per
+               region in a call tree of nested regions, and can also keep
+               individual events to dump in Chrome trace-event JSON
+               (chrome://tracing or ui.perfetto.dev).
+
+               Code that marks regions includes this header only when
+               built with -DTRACE_REGIONS and otherwise defines an empty
+               TRACE_REGION, so tracing is off unless asked for. Compile
+               with -DTRACE_DISABLED to make TRACE_REGION a no-op in code
+               that includes this header directly.
+*/
+
+/************************************************************/
+// Macro guard to prevent multiple inclusions
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/************************************************************/
+// System includes
+
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/************************************************************/
+// Local includes
+
+#include "Timer.hpp"
+
+/************************************************************/
+// Using declarations
+
+/************************************************************/
+
+class RegionRegistry
+{
+public:
+
+  // One node of a thread's call tree: a region entered from its parent
+  struct Node
+  {
+    unsigned region;
+    unsigned parent;
+    std::vector<unsigned> children;
+    uint64_t count = 0;
+    double totalMs = 0;
+    double minMs = 0;
+    double maxMs = 0;
+  };
+
+  // One completed region, kept for the Chrome trace
+  struct Event
+  {
+    unsigned region;
+    double startMs;
+    double elapsedMs;
+  };
+
+  // Everything recorded by one thread. Only that thread writes to it.
+  struct ThreadData
+  {
+    unsigned tid;
+    std::vector<Node> nodes;
+    unsigned current = 0;
+    std::vector<Event> events;
+  };
+
+  static RegionRegistry&
+  instance ()
+  {
+    static RegionRegistry registry;
+    return registry;
+  }
+
+  // Return the id of the region called name. Called once per TRACE_REGION
+  // site, so the lookup cost is not paid on every entry.
+  unsigned
+  id (const std::string& name)
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    for (unsigned i = 0; i < m_names.size (); ++i)
+    {
+      if (m_names[i] == name)
+      {
+        return i;
+      }
+    }
+    m_names.push_back (name);
+    return m_names.size () - 1;
+  }
+
+  // Keep at most limit events per thread for the Chrome trace (0 keeps
+  // none). Regions past the limit are still counted in the call tree.
+  void
+  setEventLimit (size_t limit)
+  {
+    m_eventLimit = limit;
+  }
+
+  // The calling thread's data, registered on first use
+  ThreadData&
+  thread ()
+  {
+    thread_local ThreadData* data = nullptr;
+    if (data == nullptr)
+    {
+      std::lock_guard<std::mutex> lock (m_mutex);
+      m_threads.push_back (std::make_unique<ThreadData> ());
+      data = m_threads.back ().get ();
+      data->tid = m_threads.size ();
+      data->nodes.push_back (Node {0, 0, {}});
+    }
+    return *data;
+  }
+
+  // Make region a child of the thread's current node and return that child
+  void
+  enter (ThreadData& data, unsigned region)
+  {
+    Node& parent = data.nodes[data.current];
+    for (unsigned child : parent.children)
+    {
+      if (data.nodes[child].region == region)
+      {
+        data.current = child;
+        return;
+      }
+    }
+    unsigned child = data.nodes.size ();
+    parent.children.push_back (child);
+    data.nodes.push_back (Node {region, data.current, {}});
+    data.current = child;
+  }
+
+  // Record the current node's region as taking elapsedMs and return to
+  // its parent
+  void
+  exit (ThreadData& data, double startMs, double elapsedMs)
+  {
+    Node& node = data.nodes[data.current];
+    if (node.count == 0 || elapsedMs < node.minMs)
+    {
+      node.minMs = elapsedMs;
+    }
+    if (node.count == 0 || elapsedMs > node.maxMs)
+    {
+      node.maxMs = elapsedMs;
+    }
+    ++node.count;
+    node.totalMs += elapsedMs;
+    if (data.events.size () < m_eventLimit)
+    {
+      data.events.push_back (Event {node.region, startMs, elapsedMs});
+    }
+    data.current = node.parent;
+  }
+
+  // Print every thread's call tree with count, total, min and max time.
+  // Call once the traced threads are done.
+  void
+  writeSummary (std::ostream& out)
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    out << std::left << std::setw (40) << "region" << std::setw (12)
+        << "count" << std::setw (14) << "total (ms)" << std::setw (14)
+        << "min (ms)" << "max (ms)" << std::endl;
+    for (const auto& data : m_threads)
+    {
+      out << "thread " << data->tid << std::endl;
+      writeNode (out, *data, 0, 0);
+    }
+  }
+
+  // Write every kept event as a Chrome trace-event "X" (complete) event.
+  // Call once the traced threads are done.
+  void
+  writeChromeTrace (std::ostream& out)
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    out << "{\"traceEvents\": [" << std::endl << std::fixed
+        << std::setprecision (3);
+    bool first = true;
+    for (const auto& data : m_threads)
+    {
+      for (const Event& event : data->events)
+      {
+        out << (first ? "" : ",\n") << "  {\"name\": \""
+            << m_names[event.region] << "\", \"ph\": \"X\", \"ts\": "
+            << event.startMs * 1000 << ", \"dur\": "
+            << event.elapsedMs * 1000 << ", \"pid\": 1, \"tid\": "
+            << data->tid << "}";
+        first = false;
+      }
+    }
+    out << std::endl << "]}" << std::endl;
+  }
+
+private:
+
+  RegionRegistry () = default;
+
+  void
+  writeNode (std::ostream& out, const ThreadData& data, unsigned index,
+             unsigned depth)
+  {
+    const Node& node = data.nodes[index];
+    if (index != 0)
+    {
+      std::string name =
+        std::string (2 * depth, ' ') + m_names[node.region];
+      out << std::setw (40) << name << std::setw (12) << node.count
+          << std::setw (14) << node.totalMs << std::setw (14) << node.minMs
+          << node.maxMs << std::endl;
+    }
+    for (unsigned child : node.children)
+    {
+      writeNode (out, data, child, depth + 1);
+    }
+  }
+
+  std::mutex m_mutex;
+  std::vector<std::string> m_names;
+  std::vector<std::unique_ptr<ThreadData>> m_threads;
+  size_t m_eventLimit = 1 << 20;
+};
+
+// Times its own lifetime as one entry into region
+class ScopedRegion
+{
+public:
+
+  explicit ScopedRegion (unsigned region)
+    : m_data (RegionRegistry::instance ().thread ())
+  {
+    RegionRegistry::instance ().enter (m_data, region);
+    m_timer.start ();
+  }
+
+  ScopedRegion (const ScopedRegion&) = delete;
+
+  ScopedRegion&
+  operator= (const ScopedRegion&) = delete;
+
+  ~ScopedRegion ()
+  {
+    m_timer.stop ();
+    RegionRegistry::instance ().exit (m_data, m_timer.getStartMs (),
+                                      m_timer.getElapsedMs ());
+  }
+
+private:
+
+  RegionRegistry::ThreadData& m_data;
+  Timer<> m_timer;
+};
+
+/************************************************************/
+// TRACE_REGION ("name") looks the name up once per call site and then
+// times the rest of the enclosing scope.
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_ (a, b)
+
+#ifdef TRACE_DISABLED
+#define TRACE_REGION(name)
+#else
+#define TRACE_REGION(name)                                              \
+  static const unsigned TRACE_CONCAT (traceRegionId_, __LINE__) =       \
+    RegionRegistry::instance ().id (name);                              \
+  ScopedRegion TRACE_CONCAT (traceRegion_, __LINE__) (                  \
+    TRACE_CONCAT (traceRegionId_, __LINE__))
+#endif
+
+/************************************************************/
+
+#endif
+
+/************************************************************/
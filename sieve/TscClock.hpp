@@ -0,0 +1,265 @@
+/*
+  Filename   : TscClock.hpp
+  Author     : Jaysen Hippensteel
+  Course     : Varies
+  Assignment : -
+  Description: A std::chrono compatible clock that reads the CPU's time
+               stamp counter with rdtscp, for timing calls too short for
+               the standard clocks. The counter's frequency is calibrated
+               against steady_clock the first time the clock is used.
+               Works as Timer<TscClock>. Falls back to steady_clock on
+               CPUs other than x86.
+*/
+
+/************************************************************/
+// Macro guard to prevent multiple inclusions
+
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+
+/************************************************************/
+// System includes
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TSC_CLOCK_X86 1
+#endif
+
+#ifdef TSC_CLOCK_X86
+// For the 64 x 32.32 bit multiply in now (); __extension__ keeps
+// -Wpedantic quiet about the GCC/Clang-only type
+__extension__ typedef unsigned __int128 TscProduct;
+#endif
+
+/************************************************************/
+// Local includes
+
+#include "Timer.hpp"
+
+/************************************************************/
+// Using declarations
+
+/************************************************************/
+
+class TscClock
+{
+public:
+
+  using duration = std::chrono::nanoseconds;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<TscClock>;
+  static constexpr bool is_steady = true;
+
+  // Nanoseconds since the clock was calibrated
+  static time_point
+  now () noexcept
+  {
+#ifdef TSC_CLOCK_X86
+    const Calibration& c = calibration ();
+    uint64_t ticks = readTsc () - c.baseTicks;
+    // ns = ticks * nsPerTick, with nsPerTick in 32.32 fixed point
+    TscProduct ns = (TscProduct) ticks * c.nsPerTickFixed;
+    return time_point (duration ((rep) (ns >> 32)));
+#else
+    return time_point (std::chrono::duration_cast<duration> (
+      std::chrono::steady_clock::now ().time_since_epoch ()));
+#endif
+  }
+
+  // Raw counter value. rdtscp waits for every earlier instruction to
+  // finish, and the lfence after it keeps later ones from starting early,
+  // so the read cannot drift into or out of the code being timed.
+  static uint64_t
+  readTsc () noexcept
+  {
+#ifdef TSC_CLOCK_X86
+    unsigned aux;
+    uint64_t ticks = __rdtscp (&aux);
+    _mm_lfence ();
+    return ticks;
+#else
+    return std::chrono::steady_clock::now ().time_since_epoch ().count ();
+#endif
+  }
+
+  // Counter ticks per second, as measured by calibration
+  static double
+  frequencyHz ()
+  {
+    return calibration ().hz;
+  }
+
+  // True if the CPU reports rdtscp and an invariant time stamp counter
+  // (constant rate in every power state), which this clock relies on
+  static bool
+  isInvariant ()
+  {
+#ifdef TSC_CLOCK_X86
+    unsigned eax, ebx, ecx, edx;
+    if (__get_cpuid (0x80000000, &eax, &ebx, &ecx, &edx) == 0 ||
+        eax < 0x80000007)
+    {
+      return false;
+    }
+    __get_cpuid (0x80000001, &eax, &ebx, &ecx, &edx);
+    bool rdtscp = edx & (1u << 27);
+    __get_cpuid (0x80000007, &eax, &ebx, &ecx, &edx);
+    return rdtscp && (edx & (1u << 8));
+#else
+    return false;
+#endif
+  }
+
+private:
+
+  struct Calibration
+  {
+    uint64_t baseTicks;
+    uint64_t nsPerTickFixed;
+    double hz;
+  };
+
+  // Count ticks over about 20 ms of steady_clock time. Each counter read
+  // is bracketed by two steady_clock reads, and the midpoint of the two
+  // stands for its time. Of a few tries, the one whose brackets were
+  // narrowest is kept, since a preemption between the paired reads widens
+  // the bracket and skews that try's result.
+  static Calibration
+  calibrate ()
+  {
+    using Steady = std::chrono::steady_clock;
+    double best = 0;
+    Steady::duration bestSlack {};
+    for (int attempt = 0; attempt < 3; ++attempt)
+    {
+      auto beforeStart = Steady::now ();
+      uint64_t startTicks = readTsc ();
+      auto afterStart = Steady::now ();
+      std::this_thread::sleep_for (std::chrono::milliseconds (20));
+      auto beforeStop = Steady::now ();
+      uint64_t stopTicks = readTsc ();
+      auto afterStop = Steady::now ();
+      auto slack = (afterStart - beforeStart) + (afterStop - beforeStop);
+      // Difference of the midpoints, kept in the clock's integer ticks
+      auto span = (beforeStop - beforeStart) + (afterStop - afterStart);
+      double seconds = std::chrono::duration<double> (span).count () / 2;
+      double hz = (stopTicks - startTicks) / seconds;
+      if (attempt == 0 || slack < bestSlack)
+      {
+        best = hz;
+        bestSlack = slack;
+      }
+    }
+    double nsPerTick = 1e9 / best;
+    return Calibration {readTsc (), (uint64_t) (nsPerTick * 4294967296.0),
+                        best};
+  }
+
+  static const Calibration&
+  calibration ()
+  {
+    static const Calibration c = calibrate ();
+    return c;
+  }
+};
+
+/************************************************************/
+
+// Average cost in ns of one Clock::now () call, over calls back to back
+template<typename Clock>
+double
+clockOverheadNs (unsigned calls = 1000000)
+{
+  (void) Clock::now ();  // any one-time setup
+  auto sink = Clock::now ();
+  Timer<std::chrono::steady_clock> timer;
+  timer.start ();
+  for (unsigned i = 0; i < calls; ++i)
+  {
+    auto now = Clock::now ();
+    if (now < sink)
+    {
+      sink = now;
+    }
+  }
+  timer.stop ();
+  return timer.getElapsedMs () * 1e6 / calls;
+}
+
+// Smallest nonzero difference between two consecutive Clock::now () calls,
+// in ns: the finest interval the clock can resolve in practice
+template<typename Clock>
+double
+clockResolutionNs (unsigned calls = 100000)
+{
+  double best = 0;
+  for (unsigned i = 0; i < calls; ++i)
+  {
+    auto a = Clock::now ();
+    auto b = Clock::now ();
+    double ns = std::chrono::duration<double, std::nano> (b - a).count ();
+    if (ns > 0 && (best == 0 || ns < best))
+    {
+      best = ns;
+    }
+  }
+  return best;
+}
+
+// Report the TSC calibration and the overhead and resolution of each clock
+// usable with Timer, and check TscClock against steady_clock over a sleep.
+// Returns false if the two disagree by more than 1%.
+inline bool
+reportClocks (std::ostream& out)
+{
+  out << "TSC frequency: " << std::fixed << std::setprecision (1)
+      << TscClock::frequencyHz () / 1e6 << " MHz"
+      << (TscClock::isInvariant () ? "" : " (not invariant!)") << std::endl;
+
+  out << std::left << std::setw (24) << "clock" << std::setw (16)
+      << "overhead (ns)" << "resolution (ns)" << std::endl
+      << std::setprecision (2);
+  out << std::setw (24) << "steady_clock" << std::setw (16)
+      << clockOverheadNs<std::chrono::steady_clock> ()
+      << clockResolutionNs<std::chrono::steady_clock> () << std::endl;
+  out << std::setw (24) << "system_clock" << std::setw (16)
+      << clockOverheadNs<std::chrono::system_clock> ()
+      << clockResolutionNs<std::chrono::system_clock> () << std::endl;
+  out << std::setw (24) << "high_resolution_clock" << std::setw (16)
+      << clockOverheadNs<std::chrono::high_resolution_clock> ()
+      << clockResolutionNs<std::chrono::high_resolution_clock> ()
+      << std::endl;
+  out << std::setw (24) << "TscClock" << std::setw (16)
+      << clockOverheadNs<TscClock> () << clockResolutionNs<TscClock> ()
+      << std::endl;
+
+  // Self-test: both clocks should agree on a 50 ms sleep
+  Timer<std::chrono::steady_clock> steady;
+  Timer<TscClock> tsc;
+  steady.start ();
+  tsc.start ();
+  std::this_thread::sleep_for (std::chrono::milliseconds (50));
+  tsc.stop ();
+  steady.stop ();
+  double error = (tsc.getElapsedMs () - steady.getElapsedMs ())
+    / steady.getElapsedMs ();
+  bool ok = error < 0.01 && error > -0.01;
+  out << "Self-test: steady_clock " << steady.getElapsedMs ()
+      << " ms, TscClock " << tsc.getElapsedMs () << " ms ("
+      << (ok ? "ok" : "FAILED") << ")" << std::endl;
+  return ok;
+}
+
+/************************************************************/
+
+#endif
+
+/************************************************************/
@@ -0,0 +1,27 @@
+/*
+  Filename   : Wheel.hpp
+  Author     : Jaysen Hippensteel
+  Course     : CSMC 362
+  Assignment : Sieve Of Eratosthenes
+  Description: The mod 30 wheel shared by the wheel sieve, the prime bitmap
+               and the bit kernels: which residues a wheel bitmap keeps a
+               bit for.
+*/
+
+/************************************************************/
+// Macro guard to prevent multiple inclusions
+
+#ifndef WHEEL_H
+#define WHEEL_H
+
+/************************************************************/
+
+// Residues mod 30 that are coprime to 2, 3 and 5. Byte i of a wheel bitmap
+// covers [30i, 30i+30) and bit b stands for the integer 30i + WHEEL[b].
+const unsigned WHEEL[8] = {1, 7, 11, 13, 17, 19, 23, 29};
+
+/************************************************************/
+
+#endif
+
+/************************************************************/
@@ -4,11 +4,30 @@
 #ifndef DIVIDE_AND_CONQUER_HPP_
 #define DIVIDE_AND_CONQUER_HPP_
 
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
 #include <iterator>
+#include <ranges>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include <iostream>
 
+#include "SortingNetworks.hpp"
+#include "WorkStealingPool.hpp"
+
+// Build with -DTRACE_REGIONS -I../sieve to time the regions marked with
+// TRACE_REGION (see sieve/Trace.hpp); otherwise they compile to nothing.
+#ifdef TRACE_REGIONS
+#include "Trace.hpp"
+#endif
+#ifndef TRACE_REGION
+#define TRACE_REGION(name)
+#endif
+
 // NOTE: you are forbidden from using anything from <algorithm> for this assignment
 //       EXCEPT for std::copy
 
@@ -58,7 +77,7 @@ merge (Iter1 first1, Iter1 last1, Iter2 first2, Iter2 last2, OIter out)
       ++out;
       ++first1;
     }
-    if (*first2 < *first1){
+    else {
       *out = *first2;
       ++out;
       ++first2;
@@ -117,6 +136,103 @@ partition (Iter first, Iter last, Value const& pivot)
   return std::make_pair(low, hi);
 }
 
+// Elements per block in block_partition. Offsets within a block are kept in
+// unsigned char arrays, so it must be at most 256.
+inline constexpr std::size_t PARTITION_BLOCK = 64;
+
+namespace detail
+{
+
+// Reorder [first, last) so every element for which belongsLeft is true
+// comes before every one for which it is false, and return the boundary.
+//
+// BlockQuicksort (Edelkamp and Weiss): a block of PARTITION_BLOCK elements
+// from each end is scanned without branching on the data, recording the
+// offsets of the elements on the wrong side, and then the two offset lists
+// are swapped pairwise. The scan is the only place belongsLeft is called,
+// and its result only moves a counter, so there is nothing to mispredict.
+// The last few blocks' worth of elements are finished by a plain Hoare
+// partition.
+template<typename Iter, typename Pred>
+Iter
+block_partition (Iter first, Iter last, Pred belongsLeft)
+{
+  constexpr std::size_t B = PARTITION_BLOCK;
+  unsigned char offsetsLeft[B];
+  unsigned char offsetsRight[B];
+  std::size_t numLeft = 0, numRight = 0;
+  std::size_t startLeft = 0, startRight = 0;
+  // Everything before left belongs left, everything from right on belongs
+  // right; the blocks being worked on are [left, left + B) and
+  // [right - B, right)
+  Iter left = first;
+  Iter right = last;
+  while (std::size_t (right - left) > 2 * B){
+    if (numLeft == 0){
+      startLeft = 0;
+      for (std::size_t i = 0; i < B; ++i){
+        offsetsLeft[numLeft] = i;
+        numLeft += !belongsLeft (*(left + i));
+      }
+    }
+    if (numRight == 0){
+      startRight = 0;
+      for (std::size_t i = 0; i < B; ++i){
+        offsetsRight[numRight] = i;
+        numRight += belongsLeft (*(right - 1 - i));
+      }
+    }
+    std::size_t swaps = numLeft < numRight ? numLeft : numRight;
+    for (std::size_t k = 0; k < swaps; ++k){
+      std::iter_swap (left + offsetsLeft[startLeft + k],
+                      right - 1 - offsetsRight[startRight + k]);
+    }
+    numLeft -= swaps;
+    numRight -= swaps;
+    startLeft += swaps;
+    startRight += swaps;
+    if (numLeft == 0) left += B;
+    if (numRight == 0) right -= B;
+  }
+  // At most one block is half done; its misplaced elements are simply
+  // found again here
+  while (true){
+    while (left != right && belongsLeft (*left)){
+      ++left;
+    }
+    do {
+      if (left == right) return left;
+      --right;
+    } while (!belongsLeft (*right));
+    std::iter_swap (left, right);
+    ++left;
+  }
+}
+
+} // end namespace detail
+
+// Same contract as partition: returns p1 and p2 such that
+//   [first, p1) < pivot, [p1, p2) == pivot and [p2, last) > pivot
+//
+// Built from two branch-free block partitions: [first, last) by
+// "< pivot", then what is left by "<= pivot". That compares about 1.5 N
+// times where partition compares up to 2 N, and none of the comparisons
+// decide a branch, so random keys cost no mispredictions. Not stable, and
+// the order within each group differs from partition's.
+//
+template<typename Iter, typename Value>
+std::pair<Iter, Iter>
+block_partition (Iter first, Iter last, Value const& pivot)
+{
+  Iter p1 = detail::block_partition (first, last, [&pivot] (auto const& x) {
+    return x < pivot;
+  });
+  Iter p2 = detail::block_partition (p1, last, [&pivot] (auto const& x) {
+    return !(pivot < x);
+  });
+  return std::make_pair (p1, p2);
+}
+
 // [10]
 // Given a RandomAccessRange, recursively call partition on either the
 // left half or right half until you have found the nth largest element
@@ -147,11 +263,50 @@ nth_element (Iter first, Iter last, size_t n)
   if(first+n < p1){
   	  return SortUtils::nth_element(first, p1, n);
   }
-  if(first+n >= p2){
-  	  return SortUtils::nth_element(p2, last, n-(p2-first));
+  return SortUtils::nth_element(p2, last, n-(p2-first));
+}
+
+// Sort a short range: with a sorting network if the value type has one
+// (see SortingNetworks.hpp) and the range fits, otherwise insertion_sort
+template<typename Iter>
+void
+small_sort (Iter first, Iter last);
+
+namespace detail
+{
+
+// Longest range small_sort hands to a sorting network for value type T:
+// SortingNetworks::MAX_KEYS if T is a NetworkKey and the CPU has AVX2,
+// otherwise 0
+template<typename T>
+std::size_t
+network_limit ()
+{
+  if constexpr (SortingNetworks::NetworkKey<T>){
+    return SortingNetworks::hasAvx2 () ? SortingNetworks::MAX_KEYS : 0;
+  }
+  else {
+    return 0;
+  }
+}
+
+// network_limit for the stable sorts. A sorting network is not stable,
+// which only goes unnoticed when equal values cannot be told apart: true
+// of integers, but not of floats (-0.0 == +0.0), so 0 for all but integers
+template<typename T>
+std::size_t
+stable_network_limit ()
+{
+  if constexpr (std::integral<T>){
+    return detail::network_limit<T> ();
+  }
+  else {
+    return 0;
   }
 }
 
+} // end namespace detail
+
 // [10]
 // Given a RandomAccessRange, sort using merge sort
 //
@@ -172,12 +327,27 @@ merge_sort (Iter first, Iter last)
   using T = std::iter_value_t<Iter>;
   size_t length = last - first;
   if (length == 1) return;
+  if (length <= detail::stable_network_limit<T> ()){
+    SortUtils::small_sort (first, last);
+    return;
+  }
   size_t mid = length/2;
   SortUtils::merge_sort(first, first+mid);
   SortUtils::merge_sort(first+mid, last);
-  std::vector<T> mergedVector(length);
-  SortUtils::merge(first, first+mid, first+mid, last, mergedVector.begin());
-  std::copy(mergedVector.begin(), mergedVector.end(), first);
+  TRACE_REGION ("merge_sort");
+  std::vector<T> mergedVector;
+  {
+    TRACE_REGION ("allocate");
+    mergedVector.resize(length);
+  }
+  {
+    TRACE_REGION ("merge");
+    SortUtils::merge(first, first+mid, first+mid, last, mergedVector.begin());
+  }
+  {
+    TRACE_REGION ("copy back");
+    std::copy(mergedVector.begin(), mergedVector.end(), first);
+  }
 }
 
 // Provided for you -- no need to change.
@@ -201,6 +371,38 @@ insertion_sort (Iter first, Iter last)
   }
 }
 
+template<typename Iter>
+void
+small_sort (Iter first, Iter last)
+{
+  using T = std::iter_value_t<Iter>;
+  if constexpr (SortingNetworks::NetworkKey<T>){
+    if (std::size_t (last - first) <= detail::network_limit<T> ()){
+      SortingNetworks::sort (first, last);
+      return;
+    }
+  }
+  SortUtils::insertion_sort (first, last);
+}
+
+namespace detail
+{
+
+// small_sort for the stable sorts: a sorting network only where
+// stable_network_limit allows one, otherwise insertion_sort
+template<typename Iter>
+void
+stable_small_sort (Iter first, Iter last)
+{
+  using T = std::iter_value_t<Iter>;
+  if (std::size_t (last - first) <= detail::stable_network_limit<T> ()){
+    SortUtils::small_sort (first, last);
+    return;
+  }
+  SortUtils::insertion_sort (first, last);
+}
+
+} // end namespace detail
 
 // [10]
 // Given a RandomAccessRange, sort using quick sort
@@ -220,8 +422,10 @@ quick_sort (Iter first, Iter last)
   // TODO
   // T is the type of data we are sorting
   using T = std::iter_value_t<Iter>;
-  if(last-first < 16) {
-  	  SortUtils::insertion_sort(first, last);
+  // Ranges a sorting network can take go to small_sort too
+  if(last-first < 16 ||
+     std::size_t(last-first) <= detail::network_limit<T>()) {
+  	  SortUtils::small_sort(first, last);
   	  return;
   }
   auto pivot = SortUtils::median3(first, last);
@@ -230,6 +434,1478 @@ quick_sort (Iter first, Iter last)
   SortUtils::quick_sort(p2, last);
 }
 
+// Given a RandomAccessRange, sort using heap sort: O(N log N) in the worst
+// case and no extra space, but not stable and slower than quick_sort on
+// average. Uses operator< for comparing values.
+//
+template<typename Iter>
+void
+heap_sort (Iter first, Iter last);
+
+// Given a RandomAccessRange, sort using introsort: quick_sort (with
+// block_partition in place of partition) that keeps track of its recursion
+// depth and switches to heap_sort on any range it reaches more than
+// 2 * log2(N) partitions deep. Inputs built to defeat
+// median3 (which make quick_sort take O(N^2) time and O(N) stack) still
+// sort in O(N log N). Recurses on the smaller partition and loops on the
+// larger one, so the stack never gets more than O(log N) deep.
+//
+template<typename Iter>
+void
+intro_sort (Iter first, Iter last);
+
+// Given a RandomAccessRange, find the element of rank n like nth_element,
+// in O(N) time even in the worst case (defined below)
+template<typename Iter>
+Iter
+select (Iter first, Iter last, std::size_t n);
+
+// Given a RandomAccessRange, sort using an adaptive (TimSort-style) merge
+// sort that takes advantage of order already in the input (defined below)
+template<typename Iter>
+void
+adaptive_merge_sort (Iter first, Iter last);
+
+// Ranges smaller than this are never split across threads: below it the
+// cost of starting a task outweighs the work it would take over.
+inline constexpr std::size_t PARALLEL_GRAIN = 1 << 14;
+
+namespace detail
+{
+
+// First position in the sorted range [first, last) whose value is not less
+// than value (the first place value could be inserted, keeping order)
+template<typename Iter, typename Value>
+Iter
+lower_bound (Iter first, Iter last, Value const& value)
+{
+  auto count = last - first;
+  while (count > 0){
+    auto half = count / 2;
+    if (*(first + half) < value){
+      first += half + 1;
+      count -= half + 1;
+    }
+    else {
+      count = half;
+    }
+  }
+  return first;
+}
+
+// First position in the sorted range [first, last) whose value is greater
+// than value (the last place value could be inserted, keeping order)
+template<typename Iter, typename Value>
+Iter
+upper_bound (Iter first, Iter last, Value const& value)
+{
+  auto count = last - first;
+  while (count > 0){
+    auto half = count / 2;
+    if (!(value < *(first + half))){
+      first += half + 1;
+      count -= half + 1;
+    }
+    else {
+      count = half;
+    }
+  }
+  return first;
+}
+
+// SortUtils::merge split into up to "tasks" tasks on pool (which is not
+// used, and may be null, when tasks is 1). The larger range is cut at its
+// middle value and the smaller one at the matching binary search position,
+// so the two halves of the output can be merged independently. Ties still
+// go to [first1, last1) first, as in merge.
+template<typename Iter1, typename Iter2, typename OIter>
+void
+parallel_merge (WorkStealingPool* pool, Iter1 first1, Iter1 last1,
+                Iter2 first2, Iter2 last2, OIter out, unsigned tasks)
+{
+  auto length1 = last1 - first1;
+  auto length2 = last2 - first2;
+  if (tasks <= 1 || std::size_t (length1 + length2) < PARALLEL_GRAIN){
+    SortUtils::merge (first1, last1, first2, last2, out);
+    return;
+  }
+  Iter1 mid1;
+  Iter2 mid2;
+  if (length1 >= length2){
+    mid1 = first1 + length1 / 2;
+    mid2 = detail::lower_bound (first2, last2, *mid1);
+  }
+  else {
+    mid2 = first2 + length2 / 2;
+    mid1 = detail::upper_bound (first1, last1, *mid2);
+  }
+  OIter outMid = out + (mid1 - first1) + (mid2 - first2);
+  TaskGroup group (*pool);
+  group.run ([=] {
+    detail::parallel_merge (pool, first1, mid1, first2, mid2, out,
+                            tasks / 2);
+  });
+  detail::parallel_merge (pool, mid1, last1, mid2, last2, outMid,
+                          tasks - tasks / 2);
+  group.wait ();
+}
+
+// Sort the n elements at first using the n elements at buffer as scratch.
+// The sorted result ends up at buffer if toBuffer, otherwise at first. Each
+// level sorts its halves into the other array and merges them back, so the
+// data ping-pongs between the two and is never copied back after a merge.
+// The left half runs as its own task on pool while there are tasks to
+// spare; pool is not used, and may be null, when tasks is 1.
+template<typename Iter, typename BufIter>
+void
+parallel_merge_sort (WorkStealingPool* pool, Iter first, BufIter buffer,
+                     std::size_t n, bool toBuffer, unsigned tasks)
+{
+  if (n <= 16){
+    detail::stable_small_sort (first, first + n);
+    if (toBuffer){
+      std::copy (first, first + n, buffer);
+    }
+    return;
+  }
+  std::size_t mid = n / 2;
+  if (tasks > 1 && n >= PARALLEL_GRAIN){
+    TaskGroup group (*pool);
+    group.run ([=] {
+      detail::parallel_merge_sort (pool, first, buffer, mid, !toBuffer,
+                                   tasks / 2);
+    });
+    detail::parallel_merge_sort (pool, first + mid, buffer + mid, n - mid,
+                                 !toBuffer, tasks - tasks / 2);
+    group.wait ();
+  }
+  else {
+    detail::parallel_merge_sort (pool, first, buffer, mid, !toBuffer, 1);
+    detail::parallel_merge_sort (pool, first + mid, buffer + mid, n - mid,
+                                 !toBuffer, 1);
+  }
+  if (toBuffer){
+    detail::parallel_merge (pool, first, first + mid, first + mid, first + n,
+                            buffer, tasks);
+  }
+  else {
+    detail::parallel_merge (pool, buffer, buffer + mid, buffer + mid,
+                            buffer + n, first, tasks);
+  }
+}
+
+} // end namespace detail
+
+// Given a RandomAccessRange, sort using merge sort on up to "threads"
+// threads (0 means one per hardware thread)
+//
+// The two halves of each range are sorted as separate tasks on one
+// work-stealing pool until the ranges get smaller than PARALLEL_GRAIN, and
+// merges are split across its workers by binary search, so no more than
+// "threads" threads are ever started. Unlike merge_sort, a single scratch
+// buffer is allocated once for the whole sort. Stable, like merge_sort.
+//
+template<typename Iter>
+void
+parallel_merge_sort (Iter first, Iter last, unsigned threads = 0)
+{
+  using T = std::iter_value_t<Iter>;
+  std::size_t length = last - first;
+  if (length <= 1) return;
+  if (threads == 0){
+    threads = std::thread::hardware_concurrency ();
+    if (threads == 0) threads = 1;
+  }
+  std::vector<T> buffer (length);
+  if (threads <= 1 || length < PARALLEL_GRAIN){
+    detail::parallel_merge_sort (nullptr, first, buffer.begin (), length,
+                                 false, 1);
+    return;
+  }
+  WorkStealingPool pool (threads);
+  detail::parallel_merge_sort (&pool, first, buffer.begin (), length, false,
+                               threads);
+}
+
+// Length of the runs bottom_up_merge_sort sorts with stable_small_sort
+// before it starts merging
+inline constexpr std::size_t BOTTOM_UP_RUN = 16;
+
+namespace detail
+{
+
+// One pass of bottom_up_merge_sort: merge each pair of neighboring sorted
+// runs of width elements in the n elements at from into to. A run with no
+// partner is moved over as is.
+template<typename Iter1, typename Iter2>
+void
+merge_pass (Iter1 from, Iter2 to, std::size_t n, std::size_t width)
+{
+  for (std::size_t i = 0; i < n; i += 2 * width){
+    std::size_t mid = i + width < n ? i + width : n;
+    std::size_t end = mid + width < n ? mid + width : n;
+    SortUtils::merge (from + i, from + mid, from + mid, from + end, to + i);
+  }
+}
+
+} // end namespace detail
+
+// Given a RandomAccessRange, sort using bottom-up merge sort
+//
+// Runs of BOTTOM_UP_RUN elements are sorted in place by stable_small_sort,
+// then each pass merges pairs of runs from one array into the other,
+// doubling the run width, until one run is left. Passes alternate between
+// the range and a single scratch buffer, so the sort makes one allocation
+// and nothing is copied back after a merge. The run width is halved when that makes the
+// number of passes even, so the last pass always lands back in the range.
+// Stable, like merge_sort.
+//
+template<typename Iter>
+void
+bottom_up_merge_sort (Iter first, Iter last)
+{
+  using T = std::iter_value_t<Iter>;
+  std::size_t length = last - first;
+  if (length <= 1) return;
+
+  std::size_t run = BOTTOM_UP_RUN;
+  unsigned passes = 0;
+  for (std::size_t width = run; width < length; width *= 2){
+    ++passes;
+  }
+  if (passes % 2 == 1){
+    run /= 2;
+  }
+  for (std::size_t i = 0; i < length; i += run){
+    detail::stable_small_sort (first + i,
+                               first + (i + run < length ? i + run : length));
+  }
+  if (length <= run) return;
+
+  TRACE_REGION ("bottom_up_merge_sort");
+  std::vector<T> buffer;
+  {
+    TRACE_REGION ("allocate");
+    buffer.resize (length);
+  }
+  bool inBuffer = false;
+  for (std::size_t width = run; width < length; width *= 2){
+    TRACE_REGION ("merge pass");
+    if (inBuffer){
+      detail::merge_pass (buffer.begin (), first, length, width);
+    }
+    else {
+      detail::merge_pass (first, buffer.begin (), length, width);
+    }
+    inBuffer = !inBuffer;
+  }
+}
+
+namespace detail
+{
+
+// Move first[i] down the max-heap of the n elements at first until neither
+// child is larger
+template<typename Iter>
+void
+sift_down (Iter first, std::size_t n, std::size_t i)
+{
+  while (true){
+    std::size_t child = 2 * i + 1;
+    if (child >= n) return;
+    if (child + 1 < n && *(first + child) < *(first + child + 1)){
+      ++child;
+    }
+    if (!(*(first + i) < *(first + child))) return;
+    std::iter_swap (first + i, first + child);
+    i = child;
+  }
+}
+
+template<typename Iter>
+void
+intro_sort (Iter first, Iter last, unsigned depthLimit)
+{
+  using T = std::iter_value_t<Iter>;
+  std::size_t cutoff = 16 > detail::network_limit<T> ()
+    ? 16 : detail::network_limit<T> () + 1;
+  while (std::size_t (last - first) >= cutoff){
+    if (depthLimit == 0){
+      SortUtils::heap_sort (first, last);
+      return;
+    }
+    --depthLimit;
+    auto pivot = SortUtils::median3 (first, last);
+    auto [p1, p2] = SortUtils::block_partition (first, last, pivot);
+    if (p1 - first < last - p2){
+      detail::intro_sort (first, p1, depthLimit);
+      first = p2;
+    }
+    else {
+      detail::intro_sort (p2, last, depthLimit);
+      last = p1;
+    }
+  }
+  SortUtils::small_sort (first, last);
+}
+
+} // end namespace detail
+
+template<typename Iter>
+void
+heap_sort (Iter first, Iter last)
+{
+  std::size_t length = last - first;
+  for (std::size_t i = length / 2; i-- > 0; ){
+    detail::sift_down (first, length, i);
+  }
+  while (length > 1){
+    --length;
+    std::iter_swap (first, first + length);
+    detail::sift_down (first, length, 0);
+  }
+}
+
+template<typename Iter>
+void
+intro_sort (Iter first, Iter last)
+{
+  std::size_t length = last - first;
+  if (length <= 1) return;
+  detail::intro_sort (first, last, 2 * (std::bit_width (length) - 1));
+}
+
+namespace detail
+{
+
+// partition for ranges big enough to split across the pool. The range is
+// cut into one chunk per worker; each chunk counts its elements < and ==
+// pivot, a prefix sum over the counts gives every chunk its own slice of
+// each of the three groups, and each chunk then copies its elements
+// straight to their slices in buffer, which is copied back in parallel.
+// Every step but the prefix sum (O(workers)) runs on all workers, so no
+// pass over the data is serial. buffer must have room for last - first
+// elements. Stable, unlike partition. If a comparison or copy throws, the
+// step it is in finishes on the other chunks and then the exception is
+// rethrown, so later steps never run on partial counts.
+template<typename Iter, typename BufIter, typename Value>
+std::pair<Iter, Iter>
+parallel_partition (WorkStealingPool& pool, Iter first, Iter last,
+                    BufIter buffer, Value const& pivot)
+{
+  std::size_t length = last - first;
+  std::size_t chunks = pool.size ();
+  std::size_t chunkSize = (length + chunks - 1) / chunks;
+  std::vector<std::size_t> less (chunks, 0);
+  std::vector<std::size_t> equal (chunks, 0);
+  auto chunkBegin = [&] (std::size_t c) {
+    return c * chunkSize < length ? c * chunkSize : length;
+  };
+  {
+    TaskGroup group (pool);
+    for (std::size_t c = 0; c < chunks; ++c){
+      group.run ([&, c] {
+        std::size_t l = 0, e = 0;
+        for (auto i = chunkBegin (c); i < chunkBegin (c + 1); ++i){
+          l += *(first + i) < pivot;
+          e += !(*(first + i) < pivot) && !(pivot < *(first + i));
+        }
+        less[c] = l;
+        equal[c] = e;
+      });
+    }
+    group.wait ();
+  }
+
+  // Where each chunk's first element of each group goes
+  std::vector<std::size_t> lessAt (chunks);
+  std::vector<std::size_t> equalAt (chunks);
+  std::vector<std::size_t> greaterAt (chunks);
+  std::size_t totalLess = 0, totalEqual = 0;
+  for (std::size_t c = 0; c < chunks; ++c){
+    totalLess += less[c];
+    totalEqual += equal[c];
+  }
+  std::size_t l = 0, e = totalLess, g = totalLess + totalEqual;
+  for (std::size_t c = 0; c < chunks; ++c){
+    lessAt[c] = l;
+    equalAt[c] = e;
+    greaterAt[c] = g;
+    l += less[c];
+    e += equal[c];
+    g += chunkBegin (c + 1) - chunkBegin (c) - less[c] - equal[c];
+  }
+
+  {
+    TaskGroup group (pool);
+    for (std::size_t c = 0; c < chunks; ++c){
+      group.run ([&, c] {
+        std::size_t l = lessAt[c], e = equalAt[c], g = greaterAt[c];
+        for (auto i = chunkBegin (c); i < chunkBegin (c + 1); ++i){
+          auto const& x = *(first + i);
+          if (x < pivot){
+            *(buffer + l++) = x;
+          }
+          else if (pivot < x){
+            *(buffer + g++) = x;
+          }
+          else {
+            *(buffer + e++) = x;
+          }
+        }
+      });
+    }
+    group.wait ();
+  }
+  {
+    TaskGroup group (pool);
+    for (std::size_t c = 0; c < chunks; ++c){
+      group.run ([&, c] {
+        std::copy (buffer + chunkBegin (c), buffer + chunkBegin (c + 1),
+                   first + chunkBegin (c));
+      });
+    }
+    group.wait ();
+  }
+  return std::make_pair (first + totalLess, first + totalLess + totalEqual);
+}
+
+// Partition with parallel_partition while the range is big enough for
+// every worker to get at least PARALLEL_GRAIN elements, else block_partition
+template<typename Iter, typename BufIter, typename Value>
+std::pair<Iter, Iter>
+partition_on (WorkStealingPool& pool, Iter first, Iter last, BufIter buffer,
+              Value const& pivot)
+{
+  if (std::size_t (last - first) >= pool.size () * PARALLEL_GRAIN){
+    return detail::parallel_partition (pool, first, last, buffer, pivot);
+  }
+  return SortUtils::block_partition (first, last, pivot);
+}
+
+// intro_sort's loop, with the smaller partition handed to the pool as a
+// stealable task instead of a recursive call. buffer is the scratch space
+// lined up with first.
+template<typename Iter, typename BufIter>
+void
+parallel_quick_sort (WorkStealingPool& pool, TaskGroup& group, Iter first,
+                     Iter last, BufIter buffer, unsigned depthLimit)
+{
+  while (std::size_t (last - first) >= PARALLEL_GRAIN){
+    if (depthLimit == 0){
+      SortUtils::heap_sort (first, last);
+      return;
+    }
+    --depthLimit;
+    auto pivot = SortUtils::median3 (first, last);
+    auto [p1, p2] = detail::partition_on (pool, first, last, buffer, pivot);
+    if (p1 - first < last - p2){
+      group.run ([&pool, &group, first, p1, buffer, depthLimit] {
+        detail::parallel_quick_sort (pool, group, first, p1, buffer,
+                                     depthLimit);
+      });
+      buffer += p2 - first;
+      first = p2;
+    }
+    else {
+      BufIter rightBuffer = buffer + (p2 - first);
+      group.run ([&pool, &group, p2, last, rightBuffer, depthLimit] {
+        detail::parallel_quick_sort (pool, group, p2, last, rightBuffer,
+                                     depthLimit);
+      });
+      last = p1;
+    }
+  }
+  detail::intro_sort (first, last, depthLimit);
+}
+
+} // end namespace detail
+
+// parallel_quick_sort (below) on the workers of an existing pool, for
+// callers that sort many ranges and would otherwise start and join a set
+// of threads for each
+template<typename Iter>
+void
+parallel_quick_sort (WorkStealingPool& pool, Iter first, Iter last)
+{
+  using T = std::iter_value_t<Iter>;
+  std::size_t length = last - first;
+  if (pool.size () <= 1 || length < PARALLEL_GRAIN){
+    SortUtils::intro_sort (first, last);
+    return;
+  }
+  std::vector<T> buffer (length);
+  TaskGroup group (pool);
+  detail::parallel_quick_sort (pool, group, first, last, buffer.begin (),
+                               2 * (std::bit_width (length) - 1));
+  group.wait ();
+}
+
+// Given a RandomAccessRange, sort using quick sort on a work-stealing pool
+// of "threads" threads (0 means one per hardware thread)
+//
+// While a range is big enough for every worker to get PARALLEL_GRAIN
+// elements, it is partitioned by all of them at once (parallel_partition),
+// so the first O(N) passes are not serial. After each partition the
+// smaller side becomes a task other workers can steal and the larger side
+// is kept; ranges under PARALLEL_GRAIN are finished with intro_sort. Keeps
+// intro_sort's depth limit. Not stable.
+//
+template<typename Iter>
+void
+parallel_quick_sort (Iter first, Iter last, unsigned threads = 0)
+{
+  if (threads == 0){
+    threads = std::thread::hardware_concurrency ();
+  }
+  if (threads <= 1 || std::size_t (last - first) < PARALLEL_GRAIN){
+    SortUtils::intro_sort (first, last);
+    return;
+  }
+  WorkStealingPool pool (threads);
+  SortUtils::parallel_quick_sort (pool, first, last);
+}
+
+// Ranges longer than this have their pivot picked by select from a sample
+// (Floyd-Rivest) rather than by median3
+inline constexpr std::size_t SAMPLE_SELECT = 600;
+
+// select partitions at most this many times the length of its range, in
+// total, before it switches to median of medians pivots
+inline constexpr std::size_t SELECT_WORK = 3;
+
+// nth_element on a work-stealing pool of "threads" threads (0 means one
+// per hardware thread)
+//
+// Only one side of each partition is kept, so there is nothing to hand out
+// as tasks; instead each partition of a range big enough for every worker
+// to get PARALLEL_GRAIN elements is done by all of them with
+// parallel_partition, and the rest is left to select. Like select, once
+// the partitions have covered SELECT_WORK times the length in total (an
+// input arranged against median3), the rest is left to select as well, so
+// the worst case stays O(N).
+//
+// Precondition:
+//   std::distance (begin, end) > n
+//
+template<typename Iter>
+Iter
+parallel_nth_element (Iter first, Iter last, size_t n, unsigned threads = 0)
+{
+  using T = std::iter_value_t<Iter>;
+  std::size_t length = last - first;
+  if (threads == 0){
+    threads = std::thread::hardware_concurrency ();
+  }
+  if (threads <= 1 || length < PARALLEL_GRAIN){
+    return SortUtils::select (first, last, n);
+  }
+  WorkStealingPool pool (threads);
+  std::vector<T> buffer (length);
+  auto bufferFirst = buffer.begin ();
+  std::size_t budget = SELECT_WORK * length;
+  while (std::size_t (last - first) >= PARALLEL_GRAIN){
+    if (budget < std::size_t (last - first)) break;
+    budget -= last - first;
+    auto pivot = SortUtils::median3 (first, last);
+    auto [p1, p2] = detail::partition_on (pool, first, last, bufferFirst,
+                                          pivot);
+    if (first + n < p1){
+      last = p1;
+    }
+    else if (first + n < p2){
+      return first + n;
+    }
+    else {
+      n -= p2 - first;
+      bufferFirst += p2 - first;
+      first = p2;
+    }
+  }
+  return SortUtils::select (first, last, n);
+}
+
+namespace detail
+{
+
+// Partition [first, last) around pivot and narrow it to the side holding
+// the element of rank n. Returns true if that element is already in place
+// (it equals pivot).
+template<typename Iter, typename Value>
+bool
+narrow (Iter& first, Iter& last, std::size_t& n, Value const& pivot)
+{
+  auto [p1, p2] = SortUtils::block_partition (first, last, pivot);
+  if (first + n < p1){
+    last = p1;
+  }
+  else if (first + n < p2){
+    return true;
+  }
+  else {
+    n -= p2 - first;
+    first = p2;
+  }
+  return false;
+}
+
+template<typename Iter>
+Iter
+median_of_medians_select (Iter first, Iter last, std::size_t n);
+
+// Median of the medians of groups of 5 (Blum, Floyd, Pratt, Rivest and
+// Tarjan). At least 30% of [first, last) is <= it and 30% is >= it, which
+// is what makes median_of_medians_select linear. Moves the group medians to
+// the front of the range.
+template<typename Iter>
+std::iter_value_t<Iter>
+median_of_medians (Iter first, Iter last)
+{
+  Iter medians = first;
+  for (Iter group = first; group < last; group += 5){
+    Iter end = last - group > 5 ? group + 5 : last;
+    SortUtils::insertion_sort (group, end);
+    std::iter_swap (medians, group + (end - group) / 2);
+    ++medians;
+    if (end == last) break;
+  }
+  return *detail::median_of_medians_select (first, medians,
+                                            (medians - first) / 2);
+}
+
+// Selection with a median of medians pivot every time: O(N) in the worst
+// case, but several times slower than floyd_rivest_select on average
+template<typename Iter>
+Iter
+median_of_medians_select (Iter first, Iter last, std::size_t n)
+{
+  while (true){
+    if (last - first <= 32){
+      SortUtils::small_sort (first, last);
+      return first + n;
+    }
+    auto pivot = detail::median_of_medians (first, last);
+    if (detail::narrow (first, last, n, pivot)) return first + n;
+  }
+}
+
+// Floyd-Rivest selection. For a long range, a sample is gathered around
+// where the element of rank n should fall and selected recursively so that
+// the pivot lands close to rank n; partitioning around it leaves about
+// N^(2/3) elements, so a selection costs about N + min (n, N - n) +
+// O(N^(2/3)) comparisons. Once the partitions have covered more than budget elements
+// in total (only possible on inputs arranged against the sampling) it
+// hands over to median_of_medians_select, keeping the worst case O(N).
+template<typename Iter>
+Iter
+floyd_rivest_select (Iter first, Iter last, std::size_t n,
+                     std::size_t budget)
+{
+  while (true){
+    std::size_t length = last - first;
+    if (length <= 32){
+      SortUtils::small_sort (first, last);
+      return first + n;
+    }
+    if (budget < length){
+      return detail::median_of_medians_select (first, last, n);
+    }
+    budget -= length;
+    if (length > SAMPLE_SELECT){
+      // Sample bounds from Floyd and Rivest's Algorithm 489
+      double size = length;
+      double rank = n + 1;
+      double z = std::log (size);
+      double sample = 0.5 * std::exp (2 * z / 3);
+      double spread = 0.5 * std::sqrt (z * sample * (size - sample) / size)
+        * (rank < size / 2 ? -1 : 1);
+      double low = n - rank * sample / size + spread;
+      double high = n + (size - rank) * sample / size + spread;
+      std::size_t lo = low > 0 ? std::size_t (low) : 0;
+      std::size_t hi = high < size - 1 ? std::size_t (high) : length - 1;
+      // The sample is spread over the whole range before it is used, so
+      // it is still representative when the range is partly ordered (for
+      // instance by an earlier select)
+      std::size_t sampleSize = hi - lo + 1;
+      for (std::size_t k = 0; k < sampleSize; ++k){
+        std::iter_swap (first + lo + k, first + k * length / sampleSize);
+      }
+      detail::floyd_rivest_select (first + lo, first + hi + 1, n - lo,
+                                   SELECT_WORK * sampleSize);
+    }
+    auto pivot = length > SAMPLE_SELECT ? *(first + n)
+                                        : SortUtils::median3 (first, last);
+    if (detail::narrow (first, last, n, pivot)) return first + n;
+  }
+}
+
+template<typename Iter>
+void
+multi_select (Iter first, Iter last, std::size_t* ranks,
+              std::size_t* ranksEnd, std::size_t offset)
+{
+  if (ranks == ranksEnd) return;
+  // The middle rank is selected, which also splits the range (and the
+  // remaining ranks) into the part before it and the part after it
+  std::size_t* middle = ranks + (ranksEnd - ranks) / 2;
+  std::size_t n = *middle - offset;
+  std::size_t length = last - first;
+  Iter nth = detail::floyd_rivest_select (first, last, n,
+                                          SELECT_WORK * length);
+  detail::multi_select (first, nth, ranks, middle, offset);
+  detail::multi_select (nth + 1, last, middle + 1, ranksEnd,
+                        offset + n + 1);
+}
+
+} // end namespace detail
+
+// Given a RandomAccessRange, find the element of rank n (0 is the min) and
+// return an iterator to it, like nth_element: afterwards, everything
+// before it is <= it and everything after it is >= it.
+//
+// Floyd-Rivest selection with a median-of-medians fallback (introselect
+// style): about 1.5 N comparisons for a median on average and O(N) in the
+// worst case.
+//
+// Precondition:
+//   std::distance (begin, end) > n
+//
+template<typename Iter>
+Iter
+select (Iter first, Iter last, std::size_t n)
+{
+  std::size_t length = last - first;
+  return detail::floyd_rivest_select (first, last, n, SELECT_WORK * length);
+}
+
+// Given a RandomAccessRange, put the elements of every rank in ranks in
+// place at once, as if select were called for each, and return iterators
+// to them in the same order as ranks. Used for percentiles:
+//   multi_select (v.begin (), v.end (), {n / 2, n * 9 / 10, n * 99 / 100})
+//
+// Selects the middle rank and recurses on each side with the ranks that
+// fall there, so k ranks cost O(N log k) rather than k separate O(N)
+// selections over the whole range.
+//
+// Precondition:
+//   every rank < std::distance (begin, end)
+//
+template<typename Iter>
+std::vector<Iter>
+multi_select (Iter first, Iter last, std::vector<std::size_t> const& ranks)
+{
+  std::vector<std::size_t> sorted (ranks);
+  SortUtils::insertion_sort (sorted.begin (), sorted.end ());
+  std::size_t unique = 0;
+  for (std::size_t i = 0; i < sorted.size (); ++i){
+    if (unique == 0 || sorted[unique - 1] != sorted[i]){
+      sorted[unique++] = sorted[i];
+    }
+  }
+  detail::multi_select (first, last, sorted.data (), sorted.data () + unique,
+                        0);
+  std::vector<Iter> result;
+  for (std::size_t rank : ranks){
+    result.push_back (first + rank);
+  }
+  return result;
+}
+
+// Shortest run adaptive_merge_sort merges, when the range is long enough:
+// shorter natural runs are extended to it by binary insertion
+inline constexpr std::size_t MIN_RUN = 32;
+
+// Elements in a row one run must win during a merge before
+// adaptive_merge_sort switches to galloping
+inline constexpr std::size_t MIN_GALLOP = 7;
+
+namespace detail
+{
+
+// detail::upper_bound for a value expected near first: probes first + 1,
+// + 3, + 7, ... until it passes value, then binary searches the last gap,
+// so it takes O(log k) comparisons to skip k elements
+template<typename Iter, typename Value>
+Iter
+gallop_upper_bound (Iter first, Iter last, Value const& value)
+{
+  std::size_t length = last - first;
+  std::size_t low = 0;
+  std::size_t high = 1;
+  while (high <= length && !(value < *(first + (high - 1)))){
+    low = high;
+    high = 2 * high + 1;
+  }
+  if (high > length) high = length;
+  return detail::upper_bound (first + low, first + high, value);
+}
+
+// detail::lower_bound searched the same way as gallop_upper_bound
+template<typename Iter, typename Value>
+Iter
+gallop_lower_bound (Iter first, Iter last, Value const& value)
+{
+  std::size_t length = last - first;
+  std::size_t low = 0;
+  std::size_t high = 1;
+  while (high <= length && *(first + (high - 1)) < value){
+    low = high;
+    high = 2 * high + 1;
+  }
+  if (high > length) high = length;
+  return detail::lower_bound (first + low, first + high, value);
+}
+
+// Merge the adjacent sorted runs [first, mid) and [mid, last) in place,
+// stably (ties keep the first run's elements first, as in merge), using
+// buffer for a copy of the first run.
+//
+// The part of the first run already <= the second run's first element and
+// the part of the second run already >= the first run's last element are
+// in place, so only what lies between them is merged. During the merge,
+// once one run has supplied MIN_GALLOP elements in a row, the merge
+// gallops: it finds how many more elements it can take from that run with
+// gallop_upper_bound / gallop_lower_bound and moves them as a block, which
+// makes merging runs that barely overlap close to O(log N).
+template<typename Iter, typename BufIter>
+void
+gallop_merge (Iter first, Iter mid, Iter last, BufIter buffer)
+{
+  first = detail::gallop_upper_bound (first, mid, *mid);
+  if (first == mid) return;
+  last = detail::gallop_lower_bound (mid, last, *(mid - 1));
+
+  BufIter a = buffer;
+  BufIter aLast = std::copy (first, mid, buffer);
+  Iter b = mid;
+  Iter out = first;
+  std::size_t aWins = 0;
+  std::size_t bWins = 0;
+  // out never passes b, so elements of the second run can be moved down
+  // to out in place
+  while (a != aLast && b != last){
+    if (*b < *a){
+      *out++ = *b++;
+      ++bWins;
+      aWins = 0;
+    }
+    else {
+      *out++ = *a++;
+      ++aWins;
+      bWins = 0;
+    }
+    if (aWins >= MIN_GALLOP || bWins >= MIN_GALLOP){
+      while (a != aLast && b != last){
+        BufIter aStop = detail::gallop_upper_bound (a, aLast, *b);
+        std::size_t fromA = aStop - a;
+        out = std::copy (a, aStop, out);
+        a = aStop;
+        if (a == aLast) break;
+        Iter bStop = detail::gallop_lower_bound (b, last, *a);
+        std::size_t fromB = bStop - b;
+        out = std::copy (b, bStop, out);
+        b = bStop;
+        if (fromA < MIN_GALLOP && fromB < MIN_GALLOP) break;
+      }
+      aWins = 0;
+      bWins = 0;
+    }
+  }
+  // Whatever is left of the second run is already where it belongs
+  std::copy (a, aLast, out);
+}
+
+// Extend the sorted range [first, sorted) to [first, last) by binary
+// insertion: each new element's place is found with upper_bound (after any
+// equal elements, so it is stable) and the elements after it are shifted
+// up one, instead of being swapped down one step at a time
+template<typename Iter>
+void
+binary_insertion_sort (Iter first, Iter sorted, Iter last)
+{
+  for (; sorted != last; ++sorted){
+    auto value = std::move (*sorted);
+    Iter place = detail::upper_bound (first, sorted, value);
+    for (Iter i = sorted; i != place; --i){
+      *i = std::move (*(i - 1));
+    }
+    *place = std::move (value);
+  }
+}
+
+} // end namespace detail
+
+// Given a RandomAccessRange, sort using an adaptive natural merge sort in
+// the style of TimSort (Peters)
+//
+// The range is scanned for runs that are already ascending, or strictly
+// descending (which are reversed in place; strictly, so equal elements
+// never swap). Runs shorter than a minimum length between MIN_RUN and
+// 2 * MIN_RUN are extended to it by binary insertion (or, for integers, a
+// sorting network and half as long a minimum). Runs are kept on a stack
+// whose lengths grow at least like the Fibonacci numbers, merging the top
+// ones whenever that would be broken, so every merge is between runs of
+// similar size and the stack stays O(log N) deep. Merges gallop (see
+// gallop_merge). One buffer is allocated, on the first merge.
+//
+// O(N) on sorted or reversed input, O(N log N) in the worst case. Stable,
+// like merge_sort.
+//
+template<typename Iter>
+void
+adaptive_merge_sort (Iter first, Iter last)
+{
+  using T = std::iter_value_t<Iter>;
+  std::size_t length = last - first;
+  if (length <= 1) return;
+
+  // Equal integers cannot be told apart, so for them a sorting network
+  // (which is not stable) can extend the runs; it takes at most 32 keys,
+  // so the runs are half as long
+  bool networkRuns = std::integral<T> && detail::network_limit<T> () > 0;
+  std::size_t runFloor = networkRuns ? MIN_RUN / 2 : MIN_RUN;
+
+  // minRun is the top bits of length, rounded up if any lower bit is set,
+  // so it is in [runFloor, 2 * runFloor] and length / minRun is a power of
+  // 2 or just under one
+  std::size_t minRun = length;
+  bool lowBits = false;
+  while (minRun >= 2 * runFloor){
+    lowBits = lowBits || (minRun & 1);
+    minRun >>= 1;
+  }
+  minRun += lowBits;
+
+  struct Run
+  {
+    std::size_t start;
+    std::size_t length;
+  };
+  std::vector<Run> runs;
+  std::vector<T> buffer;
+  auto mergeAt = [&] (std::size_t i) {
+    TRACE_REGION ("merge");
+    if (buffer.empty ()){
+      buffer.resize (length);
+    }
+    Iter runFirst = first + runs[i].start;
+    Iter runMid = runFirst + runs[i].length;
+    detail::gallop_merge (runFirst, runMid, runMid + runs[i + 1].length,
+                          buffer.begin ());
+    runs[i].length += runs[i + 1].length;
+    runs.erase (runs.begin () + i + 1);
+  };
+
+  TRACE_REGION ("adaptive_merge_sort");
+  std::size_t start = 0;
+  while (start < length){
+    std::size_t end = start + 1;
+    if (end < length && *(first + end) < *(first + start)){
+      while (end < length && *(first + end) < *(first + end - 1)){
+        ++end;
+      }
+      for (Iter i = first + start, j = first + end - 1; i < j; ++i, --j){
+        std::iter_swap (i, j);
+      }
+    }
+    else {
+      while (end < length && !(*(first + end) < *(first + end - 1))){
+        ++end;
+      }
+    }
+    if (end - start < minRun){
+      std::size_t forced = start + minRun < length ? start + minRun : length;
+      if (networkRuns){
+        SortUtils::small_sort (first + start, first + forced);
+      }
+      else {
+        detail::binary_insertion_sort (first + start, first + end,
+                                       first + forced);
+      }
+      end = forced;
+    }
+    runs.push_back (Run {start, end - start});
+    start = end;
+
+    // Restore len[i - 2] > len[i - 1] + len[i] and len[i - 1] > len[i]
+    // for the top runs (with the extra check that keeps it true all the way
+    // down the stack)
+    while (runs.size () > 1){
+      std::size_t n = runs.size () - 2;
+      if ((n > 0 && runs[n - 1].length <= runs[n].length + runs[n + 1].length)
+          || (n > 1 && runs[n - 2].length <= runs[n - 1].length
+                                               + runs[n].length)){
+        if (runs[n - 1].length < runs[n + 1].length) --n;
+        mergeAt (n);
+      }
+      else if (runs[n].length <= runs[n + 1].length){
+        mergeAt (n);
+      }
+      else {
+        break;
+      }
+    }
+  }
+  while (runs.size () > 1){
+    std::size_t n = runs.size () - 2;
+    if (n > 0 && runs[n - 1].length < runs[n + 1].length) --n;
+    mergeAt (n);
+  }
+}
+
+namespace detail
+{
+
+// Tournament tree over k sorted sequences that yields their elements in
+// merged order. Each internal node holds the loser of the game played
+// there and node 0 the overall winner. After the winner's sequence
+// advances only the games on its path to the root are replayed: one
+// comparison per level, log2 k in all. Ties go to the lower sequence
+// index, which makes the merge stable.
+//
+// Each sequence's next element is cached next to a flag saying it has run
+// out, and games are decided with bitwise rather than short-circuit logic,
+// so the replay can use conditional moves instead of a branch per level
+// that, on random data, is a coin toss.
+template<typename Iter>
+class LoserTree
+{
+public:
+
+  using Value = std::iter_value_t<Iter>;
+
+  LoserTree (std::vector<Iter> const& firsts, std::vector<Iter> const& lasts)
+    : m_current (firsts), m_last (lasts)
+  {
+    m_leaves = 1;
+    while (m_leaves < firsts.size ()){
+      m_leaves *= 2;
+    }
+    // Padding leaves are empty sequences, which lose every game
+    m_current.resize (m_leaves, Iter {});
+    m_last.resize (m_leaves, Iter {});
+    m_keys.resize (m_leaves);
+    m_done.resize (m_leaves);
+    for (std::size_t i = 0; i < m_leaves; ++i){
+      load (i);
+    }
+    m_tree.resize (m_leaves);
+
+    // Plays every game bottom up, keeping each node's winner in winners
+    std::vector<std::size_t> winners (2 * m_leaves);
+    for (std::size_t i = 0; i < m_leaves; ++i){
+      winners[m_leaves + i] = i;
+    }
+    for (std::size_t node = m_leaves - 1; node >= 1; --node){
+      std::size_t a = winners[2 * node];
+      std::size_t b = winners[2 * node + 1];
+      bool aWins = beats (a, b);
+      winners[node] = aWins ? a : b;
+      m_tree[node] = aWins ? b : a;
+    }
+    // With one leaf, winners[1] is that leaf
+    m_tree[0] = winners[1];
+  }
+
+  // The smallest remaining element. Only valid while any remain.
+  Value const&
+  front () const
+  {
+    return m_keys[m_tree[0]];
+  }
+
+  // Advance the winner's sequence and replay its path to the root
+  void
+  pop ()
+  {
+    std::size_t winner = m_tree[0];
+    ++m_current[winner];
+    load (winner);
+    for (std::size_t node = (m_leaves + winner) / 2; node >= 1; node /= 2){
+      std::size_t loser = m_tree[node];
+      bool swap = beats (loser, winner);
+      m_tree[node] = swap ? winner : loser;
+      winner = swap ? loser : winner;
+    }
+    m_tree[0] = winner;
+  }
+
+private:
+
+  // Cache the next element of sequence i, or mark it done
+  void
+  load (std::size_t i)
+  {
+    m_done[i] = m_current[i] == m_last[i];
+    if (!m_done[i]){
+      m_keys[i] = *m_current[i];
+    }
+  }
+
+  // True if sequence a's next element comes before sequence b's
+  bool
+  beats (std::size_t a, std::size_t b) const
+  {
+    bool less = m_keys[a] < m_keys[b];
+    bool greater = m_keys[b] < m_keys[a];
+    return (m_done[a] == 0) & (m_done[b] | less | (a < b && !greater));
+  }
+
+  std::vector<Iter> m_current;
+  std::vector<Iter> m_last;
+  std::vector<Value> m_keys;
+  std::vector<unsigned char> m_done;
+  std::vector<std::size_t> m_tree;
+  std::size_t m_leaves;
+};
+
+// Merge [firsts[i], lasts[i]) for every i into out with a LoserTree
+template<typename Iter, typename OIter>
+OIter
+kway_merge (std::vector<Iter> const& firsts, std::vector<Iter> const& lasts,
+            OIter out)
+{
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < firsts.size (); ++i){
+    total += lasts[i] - firsts[i];
+  }
+  if (total == 0) return out;
+  LoserTree<Iter> tree (firsts, lasts);
+  for (std::size_t n = 0; n < total; ++n){
+    *out = tree.front ();
+    ++out;
+    tree.pop ();
+  }
+  return out;
+}
+
+// Co-ranking for kway_merge: return how many elements of each sequence
+// come before position rank of the merged output, so the output can be
+// cut there. Each step takes the middle of the widest remaining window,
+// counts the elements of every sequence that merge before it (those <= it
+// in lower numbered sequences, < it in higher ones), and moves that window
+// and every other one past or in front of those counts. O(k^2 log^2 N).
+template<typename Iter>
+std::vector<std::size_t>
+co_rank (std::vector<Iter> const& firsts, std::vector<Iter> const& lasts,
+         std::size_t rank)
+{
+  std::size_t k = firsts.size ();
+  std::vector<std::size_t> low (k, 0);
+  std::vector<std::size_t> high (k);
+  for (std::size_t i = 0; i < k; ++i){
+    high[i] = lasts[i] - firsts[i];
+  }
+  std::vector<std::size_t> before (k);
+  while (true){
+    std::size_t widest = k;
+    for (std::size_t i = 0; i < k; ++i){
+      if (high[i] > low[i] &&
+          (widest == k || high[i] - low[i] > high[widest] - low[widest])){
+        widest = i;
+      }
+    }
+    if (widest == k) return low;
+
+    std::size_t mid = low[widest] + (high[widest] - low[widest]) / 2;
+    auto const& pivot = *(firsts[widest] + mid);
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < k; ++i){
+      if (i < widest){
+        before[i] = detail::upper_bound (firsts[i], lasts[i], pivot)
+          - firsts[i];
+      }
+      else if (i > widest){
+        before[i] = detail::lower_bound (firsts[i], lasts[i], pivot)
+          - firsts[i];
+      }
+      else {
+        before[i] = mid;
+      }
+      count += before[i];
+    }
+    if (count < rank){
+      // The pivot and everything before it are in the first rank
+      before[widest] = mid + 1;
+      for (std::size_t i = 0; i < k; ++i){
+        if (before[i] > low[i]) low[i] = before[i];
+      }
+    }
+    else {
+      for (std::size_t i = 0; i < k; ++i){
+        if (before[i] < high[i]) high[i] = before[i];
+      }
+    }
+  }
+}
+
+// The begin and end iterators of every range in ranges
+template<typename Ranges>
+auto
+range_bounds (Ranges const& ranges)
+{
+  using Iter = decltype (std::ranges::begin (*std::ranges::begin (ranges)));
+  std::pair<std::vector<Iter>, std::vector<Iter>> bounds;
+  for (auto const& range : ranges){
+    bounds.first.push_back (std::ranges::begin (range));
+    bounds.second.push_back (std::ranges::end (range));
+  }
+  return bounds;
+}
+
+} // end namespace detail
+
+// Takes a range of sorted RandomAccessRanges (a vector of vectors or of
+// spans, say) and merges them all into the iterator starting at "out",
+// like merge does for two. Uses a loser tree (see detail::LoserTree), so
+// each element costs about log2 k comparisons for k ranges. Stable: equal
+// values come out in the order of their ranges.
+//
+// Returns the iterator of one-past-the-last where we wrote to out
+//
+template<typename Ranges, typename OIter>
+OIter
+kway_merge (Ranges const& ranges, OIter out)
+{
+  auto [firsts, lasts] = detail::range_bounds (ranges);
+  return detail::kway_merge (firsts, lasts, out);
+}
+
+namespace detail
+{
+
+// parallel_kway_merge of the ranges [firsts[i], lasts[i]) on pool
+template<typename Iter, typename RandomOIter>
+RandomOIter
+parallel_kway_merge (WorkStealingPool& pool, std::vector<Iter> const& firsts,
+                     std::vector<Iter> const& lasts, RandomOIter out)
+{
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < firsts.size (); ++i){
+    total += lasts[i] - firsts[i];
+  }
+  if (pool.size () <= 1 || total < PARALLEL_GRAIN){
+    return detail::kway_merge (firsts, lasts, out);
+  }
+
+  std::size_t slices = pool.size ();
+  std::vector<std::vector<std::size_t>> cuts (slices + 1);
+  {
+    TaskGroup group (pool);
+    for (std::size_t t = 0; t <= slices; ++t){
+      group.run ([&, t] {
+        cuts[t] = detail::co_rank (firsts, lasts, total * t / slices);
+      });
+    }
+    group.wait ();
+  }
+  {
+    TaskGroup group (pool);
+    for (std::size_t t = 0; t < slices; ++t){
+      group.run ([&, t] {
+        auto sliceFirsts = firsts;
+        auto sliceLasts = firsts;
+        for (std::size_t i = 0; i < firsts.size (); ++i){
+          sliceFirsts[i] += cuts[t][i];
+          sliceLasts[i] += cuts[t + 1][i];
+        }
+        detail::kway_merge (sliceFirsts, sliceLasts,
+                            out + total * t / slices);
+      });
+    }
+    group.wait ();
+  }
+  return out + total;
+}
+
+} // end namespace detail
+
+// kway_merge on a work-stealing pool of "threads" threads (0 means one per
+// hardware thread). The output is cut into one slice per thread, and
+// co-ranking finds where each cut falls in every input range, so each
+// thread merges its own slices of the inputs into its own slice of the
+// output. Same result as kway_merge. An exception from a comparison or
+// copy is rethrown once the other slices are done.
+//
+template<typename Ranges, typename RandomOIter>
+RandomOIter
+parallel_kway_merge (Ranges const& ranges, RandomOIter out,
+                     unsigned threads = 0)
+{
+  auto [firsts, lasts] = detail::range_bounds (ranges);
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < firsts.size (); ++i){
+    total += lasts[i] - firsts[i];
+  }
+  if (threads == 0){
+    threads = std::thread::hardware_concurrency ();
+  }
+  if (threads <= 1 || total < PARALLEL_GRAIN){
+    return detail::kway_merge (firsts, lasts, out);
+  }
+  WorkStealingPool pool (threads);
+  return detail::parallel_kway_merge (pool, firsts, lasts, out);
+}
+
+// parallel_kway_merge on the workers of an existing pool, for callers that
+// merge many times and would otherwise start and join a set of threads for
+// each
+template<typename Ranges, typename RandomOIter>
+RandomOIter
+parallel_kway_merge (WorkStealingPool& pool, Ranges const& ranges,
+                     RandomOIter out)
+{
+  auto [firsts, lasts] = detail::range_bounds (ranges);
+  return detail::parallel_kway_merge (pool, firsts, lasts, out);
+}
+
+// Value types radix_sort can sort: integers (other than bool), float and
+// double. Each is mapped to an unsigned integer of the same size whose
+// order matches the value's order, and sorted by that.
+template<typename T>
+concept RadixKey = (std::integral<T> && !std::same_as<T, bool>)
+  || std::same_as<T, float> || std::same_as<T, double>;
+
+// Ranges shorter than this go to quick_sort: radix_sort's fixed costs
+// (clearing the histograms, allocating the buffer) would dominate
+inline constexpr std::size_t RADIX_CUTOFF = 256;
+
+namespace detail
+{
+
+// The unsigned key radix_sort sorts value by. Signed integers are biased
+// by flipping the sign bit, so negative values come first. Floats flip
+// every bit when negative (larger magnitude is smaller) and just the sign
+// bit otherwise, which orders them like operator<, with negative NaNs
+// first and positive NaNs last. -0 is keyed as +0, since they compare
+// equal and radix_sort is stable.
+template<RadixKey T>
+auto
+radix_key (T value)
+{
+  if constexpr (std::floating_point<T>){
+    using U = std::conditional_t<sizeof (T) == 4, std::uint32_t,
+                                 std::uint64_t>;
+    U bits = std::bit_cast<U> (value);
+    U sign = U (1) << (8 * sizeof (U) - 1);
+    if (bits == sign){
+      bits = 0;
+    }
+    return U ((bits & sign) ? ~bits : (bits | sign));
+  }
+  else if constexpr (std::is_signed_v<T>){
+    using U = std::make_unsigned_t<T>;
+    return U (U (value) ^ (U (1) << (8 * sizeof (U) - 1)));
+  }
+  else {
+    return std::make_unsigned_t<T> (value);
+  }
+}
+
+// LSD radix sort with Bits-bit digits, least significant digit first.
+// The histograms for every digit are counted in one pass over the input,
+// and each pass scatters from the range to the buffer or back, skipping
+// any digit that is the same in every key.
+template<unsigned Bits, typename Iter>
+void
+radix_sort (Iter first, Iter last)
+{
+  using T = std::iter_value_t<Iter>;
+  using U = decltype (detail::radix_key (T {}));
+  constexpr unsigned PASSES = (8 * sizeof (U) + Bits - 1) / Bits;
+  constexpr std::size_t BUCKETS = std::size_t (1) << Bits;
+  constexpr U MASK = U (BUCKETS - 1);
+  std::size_t length = last - first;
+
+  std::vector<std::size_t> counts (PASSES * BUCKETS, 0);
+  for (Iter i = first; i != last; ++i){
+    U key = detail::radix_key (*i);
+    for (unsigned pass = 0; pass < PASSES; ++pass){
+      ++counts[pass * BUCKETS + ((key >> (pass * Bits)) & MASK)];
+    }
+  }
+
+  std::vector<T> buffer (length);
+  bool inBuffer = false;
+  for (unsigned pass = 0; pass < PASSES; ++pass){
+    std::size_t* count = &counts[pass * BUCKETS];
+    U firstDigit = (detail::radix_key (*first) >> (pass * Bits)) & MASK;
+    if (count[firstDigit] == length) continue;
+
+    // Turns the counts into each bucket's first index
+    std::size_t sum = 0;
+    for (std::size_t b = 0; b < BUCKETS; ++b){
+      std::size_t c = count[b];
+      count[b] = sum;
+      sum += c;
+    }
+    auto scatter = [&] (auto from, auto fromLast, auto to) {
+      for (; from != fromLast; ++from){
+        U digit = (detail::radix_key (*from) >> (pass * Bits)) & MASK;
+        *(to + count[digit]++) = *from;
+      }
+    };
+    if (inBuffer){
+      scatter (buffer.begin (), buffer.end (), first);
+    }
+    else {
+      scatter (first, last, buffer.begin ());
+    }
+    inBuffer = !inBuffer;
+  }
+  if (inBuffer){
+    std::copy (buffer.begin (), buffer.end (), first);
+  }
+}
+
+} // end namespace detail
+
+// Given a RandomAccessRange of RadixKey values, sort using LSD radix sort
+//
+// Keys 32 bits or wider use 11 bit digits once there are enough elements
+// (2^16) to fill 2048 buckets, which takes a 32 bit key in 3 passes
+// instead of 4; otherwise digits are 8 bits. Ranges under RADIX_CUTOFF use
+// quick_sort, or bottom_up_merge_sort for floats, where equal values can
+// differ (-0 and +0). O(N) time and O(N) extra space. Stable.
+//
+template<typename Iter>
+  requires RadixKey<std::iter_value_t<Iter>>
+void
+radix_sort (Iter first, Iter last)
+{
+  using T = std::iter_value_t<Iter>;
+  std::size_t length = last - first;
+  if (length < RADIX_CUTOFF){
+    if constexpr (std::floating_point<T>){
+      SortUtils::bottom_up_merge_sort (first, last);
+    }
+    else {
+      SortUtils::quick_sort (first, last);
+    }
+  }
+  else if (sizeof (T) >= 4 && length >= (std::size_t (1) << 16)){
+    detail::radix_sort<11> (first, last);
+  }
+  else {
+    detail::radix_sort<8> (first, last);
+  }
+}
+
+// Given a RandomAccessRange, sort it with the best sort for its value type:
+// radix_sort if it is a RadixKey, otherwise intro_sort
+//
+template<typename Iter>
+void
+sort (Iter first, Iter last)
+{
+  if constexpr (RadixKey<std::iter_value_t<Iter>>){
+    SortUtils::radix_sort (first, last);
+  }
+  else {
+    SortUtils::intro_sort (first, last);
+  }
+}
+
 } // end namespace util
 
 #endif
@@ -0,0 +1,94 @@
+/***************************************************
+ Name: Jaysen Hippensteel
+ Course: CSMC 362
+ Date: 12/3/25
+ Assignment: Sorts
+ Description: Sorts a binary file of uint64 keys that can be larger than
+ memory with SortUtils::external_sort (see ExternalSort.hpp), or writes a
+ file of random keys to try it on
+ File: ExternalSort.cpp
+
+ ***************************************************/
+
+//Includes
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "ExternalSort.hpp"
+#include "../sieve/Timer.hpp"
+
+//Writes count random uint64 keys to path, a million at a time
+int
+generate (const std::string& path, unsigned long count)
+{
+    std::ofstream file (path, std::ios::binary | std::ios::trunc);
+    if (!file){
+        std::cerr << "Could not write " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::mt19937_64 rng (362);
+    std::vector<uint64_t> keys (1000000);
+    while (count > 0){
+        unsigned long n = count < keys.size () ? count : keys.size ();
+        for (unsigned long i = 0; i < n; ++i){
+            keys[i] = rng ();
+        }
+        file.write (reinterpret_cast<const char*> (keys.data ()),
+                    n * sizeof (uint64_t));
+        count -= n;
+    }
+    return file ? 0 : EXIT_FAILURE;
+}
+
+int
+main (int argc, char* argv[])
+{
+    if (argc == 4 && std::string (argv[1]) == "generate"){
+        return generate (argv[2], std::stoul (argv[3]));
+    }
+
+    //Options come in pairs before the input and output files
+    SortUtils::ExternalSortOptions options;
+    int arg = 1;
+    for (; arg + 2 < argc; arg += 2){
+        std::string flag (argv[arg]);
+        if (flag == "-m"){
+            options.memory = std::stoul (argv[arg + 1]) << 20;
+        }
+        else if (flag == "-j"){
+            options.threads = std::stoul (argv[arg + 1]);
+        }
+        else if (flag == "-t"){
+            options.tempDirectory = argv[arg + 1];
+        }
+        else {
+            break;
+        }
+    }
+    if (arg + 2 != argc){
+        std::cerr << "Usage: " << argv[0] << " [-m <MiB>] [-j <threads>]"
+        << " [-t <temp dir>] <input> <output>" << std::endl
+        << "       " << argv[0] << " generate <file> <count>" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    Timer timer = Timer();
+    timer.start();
+    unsigned long count = 0;
+    try {
+        count = SortUtils::external_sort<uint64_t> (argv[arg], argv[arg + 1],
+                                                    options);
+    }
+    catch (const std::exception& e){
+        std::cerr << e.what () << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    timer.stop();
+    std::cout << "Sorted " << count << " keys" << std::endl;
+    std::cout << "Time: " << timer.getElapsedMs() << " ms" << std::endl;
+    return 0;
+}
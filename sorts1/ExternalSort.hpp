@@ -0,0 +1,482 @@
+// File: ExternalSort.hpp
+// Author: Jaysen Hippensteel
+//
+// Sorting files of fixed-width records that are too big for memory. The
+// input is read a chunk at a time, each chunk sorted with the in-memory
+// sorts in DivideAndConquer.hpp and spilled to a temporary file as a
+// sorted run, with the next chunk read on another thread meanwhile. The
+// runs are then merged with kway_merge: every run is read in large blocks,
+// the next block prefetched while the current one is merged, and the
+// output is written from one buffer while the next fills. All I/O is big
+// sequential pread and write calls, so this needs a POSIX system.
+
+#ifndef EXTERNAL_SORT_HPP_
+#define EXTERNAL_SORT_HPP_
+
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "DivideAndConquer.hpp"
+
+namespace SortUtils
+{
+
+// How much of the machine external_sort may use
+struct ExternalSortOptions
+{
+  // Bytes of buffers: the chunks while making runs, the blocks while
+  // merging them. Leave room for the page cache; for 50 GB on a 16 GB
+  // machine doing nothing else, 12 GB gives 13 runs and one merge pass.
+  std::size_t memory = std::size_t (1) << 30;
+  // Where runs are spilled. Needs as much free space as the input.
+  std::string tempDirectory = "/tmp";
+  // Threads for sorting chunks and merging (0 means one per hardware
+  // thread). With one, chunks of radix keys are radix sorted.
+  unsigned threads = 1;
+};
+
+// Merge blocks smaller than this spend more time seeking between runs than
+// reading them, so when there are too many runs to give each a block this
+// big, they are merged in more than one pass
+inline constexpr std::size_t EXTERNAL_MIN_BLOCK = std::size_t (1) << 20;
+
+namespace detail
+{
+
+// An open file descriptor, closed when it goes out of scope
+class File
+{
+public:
+
+  File (int fd, std::string name)
+    : m_fd (fd), m_name (std::move (name))
+  {
+  }
+
+  File (File&& other) noexcept
+    : m_fd (std::exchange (other.m_fd, -1)), m_name (std::move (other.m_name))
+  {
+  }
+
+  File&
+  operator= (File&& other) noexcept
+  {
+    std::swap (m_fd, other.m_fd);
+    std::swap (m_name, other.m_name);
+    return *this;
+  }
+
+  ~File ()
+  {
+    if (m_fd >= 0){
+      ::close (m_fd);
+    }
+  }
+
+  int
+  fd () const
+  {
+    return m_fd;
+  }
+
+  std::string const&
+  name () const
+  {
+    return m_name;
+  }
+
+private:
+
+  int m_fd;
+  std::string m_name;
+};
+
+[[noreturn]] inline void
+throw_io_error (std::string const& what, std::string const& name)
+{
+  throw std::system_error (errno, std::generic_category (), what + " " + name);
+}
+
+inline File
+open_file (std::string const& name, int flags)
+{
+  int fd = ::open (name.c_str (), flags, 0644);
+  if (fd < 0){
+    throw_io_error ("cannot open", name);
+  }
+  // Runs and the input are only ever read front to back
+  ::posix_fadvise (fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  return File (fd, name);
+}
+
+// A new file in directory that is unlinked as soon as it is created, so
+// it goes away when closed even if the sort is killed
+inline File
+temp_file (std::string const& directory)
+{
+  std::string name = directory + "/sortrun.XXXXXX";
+  int fd = ::mkstemp (name.data ());
+  if (fd < 0){
+    throw_io_error ("cannot create", name);
+  }
+  ::unlink (name.c_str ());
+  return File (fd, name);
+}
+
+// Read bytes from file at offset into data, failing at end of file
+inline void
+read_at (File const& file, void* data, std::size_t bytes, std::size_t offset)
+{
+  char* next = static_cast<char*> (data);
+  while (bytes > 0){
+    ssize_t got = ::pread (file.fd (), next, bytes, offset);
+    if (got < 0 && errno == EINTR) continue;
+    if (got < 0) throw_io_error ("cannot read", file.name ());
+    if (got == 0){
+      throw std::runtime_error ("unexpected end of file in " + file.name ());
+    }
+    next += got;
+    bytes -= got;
+    offset += got;
+  }
+}
+
+// Append bytes from data to file
+inline void
+write_all (File const& file, void const* data, std::size_t bytes)
+{
+  char const* next = static_cast<char const*> (data);
+  while (bytes > 0){
+    ssize_t put = ::write (file.fd (), next, bytes);
+    if (put < 0 && errno == EINTR) continue;
+    if (put < 0) throw_io_error ("cannot write", file.name ());
+    next += put;
+    bytes -= put;
+  }
+}
+
+// A sorted run in a temporary file
+struct Run
+{
+  File file;
+  std::size_t records;
+};
+
+// Sort a chunk on pool, or on this thread if there is no pool
+template<typename T>
+void
+sort_chunk (T* first, T* last, WorkStealingPool* pool)
+{
+  if (pool){
+    SortUtils::parallel_quick_sort (*pool, first, last);
+  }
+  else {
+    SortUtils::sort (first, last);
+  }
+}
+
+// An uninitialized array of n records. Every buffer here is filled by a
+// read or a merge before it is used, and zeroing gigabytes first would
+// fault every page in twice.
+template<typename T>
+std::unique_ptr<T[]>
+buffer (std::size_t n)
+{
+  return std::make_unique_for_overwrite<T[]> (n);
+}
+
+// Sort the records of input a chunk at a time into runs, reading each
+// chunk while the one before it is sorted and written
+template<typename T>
+std::vector<Run>
+make_runs (File const& input, std::size_t records, std::size_t chunk,
+           std::string const& directory, WorkStealingPool* pool)
+{
+  std::vector<Run> runs;
+  std::unique_ptr<T[]> current = buffer<T> (chunk);
+  std::unique_ptr<T[]> next = buffer<T> (chunk);
+  std::size_t length = records < chunk ? records : chunk;
+  read_at (input, current.get (), length * sizeof (T), 0);
+  for (std::size_t start = 0; start < records; ){
+    std::size_t nextStart = start + length;
+    std::size_t nextLength = records - nextStart < chunk
+      ? records - nextStart : chunk;
+    std::future<void> reading = std::async (std::launch::async, [&] {
+      read_at (input, next.get (), nextLength * sizeof (T),
+               nextStart * sizeof (T));
+    });
+    {
+      TRACE_REGION ("external_sort/run");
+      sort_chunk (current.get (), current.get () + length, pool);
+    }
+    runs.push_back (Run {temp_file (directory), length});
+    write_all (runs.back ().file, current.get (), length * sizeof (T));
+    reading.get ();
+    std::swap (current, next);
+    start = nextStart;
+    length = nextLength;
+  }
+  return runs;
+}
+
+// Streams a run in blocks, reading the next block on another thread while
+// the current one is merged. Holds a pointer to itself in that thread, so
+// it must not move (the readers live in a deque).
+template<typename T>
+class RunReader
+{
+public:
+
+  RunReader (Run const& run, std::size_t block)
+    : m_run (run), m_block (block), m_current (buffer<T> (block)),
+      m_next (buffer<T> (block))
+  {
+    prefetch ();
+    refill ();
+  }
+
+  RunReader (RunReader const&) = delete;
+
+  // The records of the current block not merged yet
+  T const*
+  begin () const
+  {
+    return m_current.get () + m_position;
+  }
+
+  T const*
+  end () const
+  {
+    return m_current.get () + m_size;
+  }
+
+  // Mark the current block merged up to position
+  void
+  consume (T const* position)
+  {
+    m_position = position - m_current.get ();
+  }
+
+  // Once the current block is merged, swap in the prefetched one and start
+  // on the one after. Returns false when the run has no more records.
+  bool
+  refill ()
+  {
+    if (m_nextSize == 0) return false;
+    m_reading.get ();
+    std::swap (m_current, m_next);
+    m_size = m_nextSize;
+    m_position = 0;
+    prefetch ();
+    return true;
+  }
+
+private:
+
+  void
+  prefetch ()
+  {
+    std::size_t left = m_run.records - m_read;
+    m_nextSize = left < m_block ? left : m_block;
+    if (m_nextSize == 0) return;
+    std::size_t offset = m_read;
+    m_read += m_nextSize;
+    m_reading = std::async (std::launch::async, [this, offset] {
+      read_at (m_run.file, m_next.get (), m_nextSize * sizeof (T),
+               offset * sizeof (T));
+    });
+  }
+
+  Run const& m_run;
+  std::size_t m_block;
+  std::unique_ptr<T[]> m_current;
+  std::unique_ptr<T[]> m_next;
+  std::size_t m_position = 0;
+  std::size_t m_size = 0;
+  std::size_t m_nextSize = 0;
+  std::size_t m_read = 0;
+  std::future<void> m_reading;
+};
+
+// Merge runs into output in one pass, reading each with a block of block
+// records. Works in rounds: every record no greater than the smallest last
+// record of the current blocks can be merged without reading further, and
+// that includes the whole block it came from, so each round frees at
+// least one block for its prefetched successor. Each round's output is
+// written while the next round merges. Rounds are merged on pool, or on
+// this thread if there is no pool.
+template<typename T>
+void
+merge_runs (std::vector<Run> const& runs, File const& output,
+            std::size_t block, WorkStealingPool* pool)
+{
+  std::deque<RunReader<T>> readers;
+  for (Run const& run : runs){
+    readers.emplace_back (run, block);
+  }
+  std::unique_ptr<T[]> merged = buffer<T> (runs.size () * block);
+  std::unique_ptr<T[]> writing = buffer<T> (runs.size () * block);
+  std::future<void> written;
+  std::vector<std::span<T const>> slices;
+  while (true){
+    T const* bound = nullptr;
+    for (RunReader<T>& reader : readers){
+      if (reader.begin () == reader.end () && !reader.refill ()) continue;
+      if (!bound || *(reader.end () - 1) < *bound){
+        bound = reader.end () - 1;
+      }
+    }
+    if (!bound) break;
+
+    slices.clear ();
+    std::size_t count = 0;
+    for (RunReader<T>& reader : readers){
+      T const* stop = detail::upper_bound (reader.begin (), reader.end (),
+                                           *bound);
+      slices.emplace_back (reader.begin (), stop);
+      count += stop - reader.begin ();
+    }
+    {
+      TRACE_REGION ("external_sort/merge");
+      if (pool){
+        SortUtils::parallel_kway_merge (*pool, slices, merged.get ());
+      }
+      else {
+        SortUtils::kway_merge (slices, merged.get ());
+      }
+    }
+    // Only now, since bound points into a block
+    for (std::size_t i = 0; i < readers.size (); ++i){
+      readers[i].consume (slices[i].data () + slices[i].size ());
+    }
+
+    if (written.valid ()){
+      written.get ();
+    }
+    std::swap (merged, writing);
+    written = std::async (std::launch::async, [&output, &writing, count] {
+      write_all (output, writing.get (), count * sizeof (T));
+    });
+  }
+  if (written.valid ()){
+    written.get ();
+  }
+}
+
+} // end namespace detail
+
+// Sort the file input, a packed array of records of type T, into the file
+// output (created or truncated), using about options.memory bytes of
+// buffers. Records are ordered with operator< like the other sorts, so
+// something like a struct with a key and a payload works as well as bare
+// keys. Not stable. Runs are spilled to options.tempDirectory; if there
+// are too many for blocks of EXTERNAL_MIN_BLOCK bytes, groups of them are
+// merged into longer runs first.
+//
+// Returns the number of records sorted. I/O errors throw std::system_error;
+// an input that is not a whole number of records, or an output that is the
+// input file, throws std::invalid_argument.
+//
+template<typename T>
+  requires std::is_trivially_copyable_v<T> && std::default_initializable<T>
+std::size_t
+external_sort (std::string const& input, std::string const& output,
+               ExternalSortOptions const& options = {})
+{
+  unsigned threads = options.threads;
+  if (threads == 0){
+    threads = std::thread::hardware_concurrency ();
+    if (threads == 0) threads = 1;
+  }
+
+  detail::File in = detail::open_file (input, O_RDONLY);
+  struct stat status;
+  if (::fstat (in.fd (), &status) != 0){
+    detail::throw_io_error ("cannot stat", input);
+  }
+  std::size_t bytes = status.st_size;
+  if (bytes % sizeof (T) != 0){
+    throw std::invalid_argument (input + " is not a whole number of records");
+  }
+  std::size_t records = bytes / sizeof (T);
+  // Opening output truncates it, so it must not be the input under another
+  // name (or the same one)
+  struct stat outputStatus;
+  if (::stat (output.c_str (), &outputStatus) == 0 &&
+      outputStatus.st_dev == status.st_dev &&
+      outputStatus.st_ino == status.st_ino){
+    throw std::invalid_argument (output + " is the input file " + input);
+  }
+  detail::File out = detail::open_file (output, O_WRONLY | O_CREAT | O_TRUNC);
+  if (records == 0) return 0;
+
+  // One set of workers for every chunk sort and merge round, rather than
+  // a new set for each
+  std::optional<WorkStealingPool> workers;
+  if (threads > 1){
+    workers.emplace (threads);
+  }
+  WorkStealingPool* pool = workers ? &*workers : nullptr;
+
+  // Making runs holds two chunks, plus radix_sort's buffer for a third
+  std::size_t chunk = options.memory / (3 * sizeof (T));
+  if (chunk == 0) chunk = 1;
+  if (records <= chunk){
+    std::unique_ptr<T[]> all = detail::buffer<T> (records);
+    detail::read_at (in, all.get (), bytes, 0);
+    detail::sort_chunk (all.get (), all.get () + records, pool);
+    detail::write_all (out, all.get (), bytes);
+    return records;
+  }
+  std::vector<detail::Run> runs = detail::make_runs<T> (
+    in, records, chunk, options.tempDirectory, pool);
+
+  // Merging holds two blocks per run and two output buffers of a block
+  // per run: four blocks per run in all
+  std::size_t fanIn = options.memory / (4 * EXTERNAL_MIN_BLOCK);
+  if (fanIn < 2) fanIn = 2;
+  while (runs.size () > fanIn){
+    std::vector<detail::Run> longer;
+    std::size_t block = options.memory / (4 * fanIn * sizeof (T));
+    if (block == 0) block = 1;
+    for (std::size_t i = 0; i < runs.size (); i += fanIn){
+      // Moved out so each group's files are deleted once merged
+      std::vector<detail::Run> group;
+      std::size_t length = 0;
+      for (std::size_t j = i; j < runs.size () && j < i + fanIn; ++j){
+        length += runs[j].records;
+        group.push_back (std::move (runs[j]));
+      }
+      longer.push_back (
+        detail::Run {detail::temp_file (options.tempDirectory), length});
+      detail::merge_runs<T> (group, longer.back ().file, block, pool);
+    }
+    runs = std::move (longer);
+  }
+  std::size_t block = options.memory / (4 * runs.size () * sizeof (T));
+  if (block == 0) block = 1;
+  detail::merge_runs<T> (runs, out, block, pool);
+  return records;
+}
+
+} // end namespace SortUtils
+
+#endif
@@ -0,0 +1,187 @@
+// File: SortingNetworks.hpp
+// Author: Jaysen Hippensteel
+//
+// Bitonic sorting networks for up to 32 32-bit keys held in AVX2 registers
+// (8 keys per register, 1, 2 or 4 registers). Every compare-exchange is a
+// vector min and max followed by a blend, so there are no data-dependent
+// branches and no element-by-element swaps. Used by SortUtils::small_sort
+// as the base case of the sorts in DivideAndConquer.hpp; int, unsigned and
+// float are sorted here, other types (or CPUs without AVX2) fall back to
+// insertion sort.
+
+#ifndef SORTING_NETWORKS_HPP_
+#define SORTING_NETWORKS_HPP_
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SORTING_NETWORKS_X86 1
+#endif
+
+namespace SortingNetworks
+{
+
+// Longest range sort can take
+inline constexpr std::size_t MAX_KEYS = 32;
+
+// Value types the networks can sort: anything that maps onto a signed
+// 32 bit key with the same order
+template<typename T>
+concept NetworkKey = std::same_as<T, std::int32_t>
+  || std::same_as<T, std::uint32_t> || std::same_as<T, float>;
+
+// value as a signed 32 bit key ordered like value. Unsigned values flip
+// the sign bit; negative floats flip every bit but the sign, so larger
+// magnitudes compare smaller. Both maps are their own inverse.
+template<NetworkKey T>
+std::int32_t
+toKey (T value)
+{
+  if constexpr (std::same_as<T, float>){
+    std::int32_t bits = std::bit_cast<std::int32_t> (value);
+    return bits ^ ((bits >> 31) & 0x7FFFFFFF);
+  }
+  else if constexpr (std::same_as<T, std::uint32_t>){
+    return std::int32_t (value ^ 0x80000000u);
+  }
+  else {
+    return value;
+  }
+}
+
+template<NetworkKey T>
+T
+fromKey (std::int32_t key)
+{
+  if constexpr (std::same_as<T, float>){
+    return std::bit_cast<float> (key ^ ((key >> 31) & 0x7FFFFFFF));
+  }
+  else if constexpr (std::same_as<T, std::uint32_t>){
+    return std::uint32_t (key) ^ 0x80000000u;
+  }
+  else {
+    return key;
+  }
+}
+
+#ifdef SORTING_NETWORKS_X86
+
+// Swap every lane with the one j lanes away (j = 1, 2 or 4)
+__attribute__ ((target ("avx2"))) inline __m256i
+partnerLanes (__m256i v, unsigned j)
+{
+  if (j == 1) return _mm256_shuffle_epi32 (v, 0xB1);
+  if (j == 2) return _mm256_shuffle_epi32 (v, 0x4E);
+  return _mm256_permute2x128_si256 (v, v, 1);
+}
+
+// Bitonic sort of the 8 * Registers keys at keys, ascending. Key i lives in
+// lane i % 8 of register i / 8. For each merge size k and distance j, key i
+// is compared with key i ^ j and keeps the smaller one if it is the lower
+// of the two in a block sorting up (or the higher in a block sorting down).
+// Distances of 8 or more pair whole registers; smaller ones pair lanes
+// within a register.
+template<unsigned Registers>
+__attribute__ ((target ("avx2"))) inline void
+bitonicAvx2 (std::int32_t* keys)
+{
+  __m256i v[Registers];
+  for (unsigned r = 0; r < Registers; ++r){
+    v[r] = _mm256_loadu_si256 (
+      reinterpret_cast<const __m256i*> (keys + 8 * r));
+  }
+  const __m256i lanes = _mm256_setr_epi32 (0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i zero = _mm256_setzero_si256 ();
+  for (unsigned k = 2; k <= 8 * Registers; k *= 2){
+    for (unsigned j = k / 2; j > 0; j /= 2){
+      if (j >= 8){
+        unsigned step = j / 8;
+        for (unsigned r = 0; r < Registers; ++r){
+          if (r & step) continue;
+          __m256i low = _mm256_min_epi32 (v[r], v[r + step]);
+          __m256i high = _mm256_max_epi32 (v[r], v[r + step]);
+          bool up = ((8 * r) & k) == 0;
+          v[r] = up ? low : high;
+          v[r + step] = up ? high : low;
+        }
+      }
+      else {
+        for (unsigned r = 0; r < Registers; ++r){
+          __m256i other = partnerLanes (v[r], j);
+          __m256i low = _mm256_min_epi32 (v[r], other);
+          __m256i high = _mm256_max_epi32 (v[r], other);
+          // Lane i keeps the larger key when exactly one of i & j (it is
+          // the higher of the pair) and i & k (its block sorts down) is set
+          __m256i index =
+            _mm256_add_epi32 (lanes, _mm256_set1_epi32 (8 * r));
+          __m256i lowerOfPair = _mm256_cmpeq_epi32 (
+            _mm256_and_si256 (index, _mm256_set1_epi32 (j)), zero);
+          __m256i blockUp = _mm256_cmpeq_epi32 (
+            _mm256_and_si256 (index, _mm256_set1_epi32 (k)), zero);
+          __m256i takeHigh = _mm256_xor_si256 (lowerOfPair, blockUp);
+          v[r] = _mm256_blendv_epi8 (low, high, takeHigh);
+        }
+      }
+    }
+  }
+  for (unsigned r = 0; r < Registers; ++r){
+    _mm256_storeu_si256 (reinterpret_cast<__m256i*> (keys + 8 * r), v[r]);
+  }
+}
+
+#endif
+
+// True if the AVX2 networks can run on this CPU
+inline bool
+hasAvx2 ()
+{
+#ifdef SORTING_NETWORKS_X86
+  static const bool avx2 = __builtin_cpu_supports ("avx2");
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+// Sort [first, last), at most MAX_KEYS long, with the smallest network
+// (8, 16 or 32 keys) that holds it; the unused keys are padded with the
+// largest key so they sort to the end. Requires hasAvx2 ().
+template<typename Iter>
+  requires NetworkKey<std::iter_value_t<Iter>>
+void
+sort (Iter first, Iter last)
+{
+#ifdef SORTING_NETWORKS_X86
+  using T = std::iter_value_t<Iter>;
+  std::size_t length = last - first;
+  alignas (32) std::int32_t keys[MAX_KEYS];
+  for (std::size_t i = 0; i < length; ++i){
+    keys[i] = toKey (*(first + i));
+  }
+  std::size_t size = length <= 8 ? 8 : length <= 16 ? 16 : 32;
+  for (std::size_t i = length; i < size; ++i){
+    keys[i] = INT32_MAX;
+  }
+  if (size == 8){
+    bitonicAvx2<1> (keys);
+  }
+  else if (size == 16){
+    bitonicAvx2<2> (keys);
+  }
+  else {
+    bitonicAvx2<4> (keys);
+  }
+  for (std::size_t i = 0; i < length; ++i){
+    *(first + i) = fromKey<T> (keys[i]);
+  }
+#endif
+}
+
+} // end namespace SortingNetworks
+
+#endif
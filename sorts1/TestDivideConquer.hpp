@@ -1,10 +1,23 @@
 #include "DivideAndConquer.hpp"
+#include "ExternalSort.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iterator>
+#include <limits>
+#include <mutex>
 #include <random>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
+#include <unistd.h>
+
 #include <catch2/catch_all.hpp>
 
 SCENARIO ("median3 works", "[median3]")
@@ -267,6 +280,47 @@ SCENARIO ("partition works", "[partition]")
   }
 }
 
+SCENARIO ("block_partition works", "[block_partition]")
+{
+  int const pivot = GENERATE (range (0, 12));
+  std::vector<int> v;
+  const int seed = 1337;
+  std::minstd_rand rng (seed);
+  // Enough elements that several blocks are swapped before the scalar
+  // finish
+  for (int i = 1; i <= 10; ++i)
+  {
+    v.insert (v.end (), 1 + rng () % 100, i);
+  }
+  std::shuffle (v.begin (), v.end (), rng);
+  GIVEN ("A vector with many duplicates")
+  {
+    std::vector<int> copy (v);
+    WHEN ("We pick a pivot, possibly outside the values")
+    {
+      auto [p1, p2] = SortUtils::block_partition (v.begin (), v.end (), pivot);
+      CAPTURE (pivot);
+      THEN ("[1.5] the vector is properly partitioned")
+      {
+        auto iter = v.begin ();
+        while (iter != v.end () && *iter < pivot)
+          ++iter;
+        REQUIRE (iter == p1);
+        while (iter != v.end () && *iter == pivot)
+          ++iter;
+        REQUIRE (iter == p2);
+        while (iter != v.end () && *iter > pivot)
+          ++iter;
+        REQUIRE (iter == v.end ());
+        std::sort (v.begin (), v.end ());
+        std::sort (copy.begin (), copy.end ());
+        INFO ("There were no loss of elements");
+        REQUIRE (v == copy);
+      }
+    }
+  }
+}
+
 SCENARIO ("nth_element works", "[nth_element]")
 {
   std::vector<int> v (40);
@@ -326,6 +380,91 @@ SCENARIO ("merge_sort works", "[merge_sort]")
   }
 }
 
+SCENARIO ("parallel_merge_sort works", "[parallel_merge_sort]")
+{
+  GIVEN ("A vector large enough to be split across threads")
+  {
+    std::vector<int> v (100003);
+    std::iota (v.begin (), v.begin () + v.size() / 2, 1);
+    std::iota (v.begin() + v.size() / 2, v.end(), v.size() / 4);
+    std::vector<int> expected (v);
+    std::sort (expected.begin(), expected.end());
+    std::shuffle (v.begin (), v.end (), std::minstd_rand{2047});
+    WHEN ("We call parallel_merge_sort with 4 threads")
+    {
+      SortUtils::parallel_merge_sort (v.begin (), v.end (), 4);
+      THEN ("[10] We get the right answer")
+      {
+        REQUIRE (expected == v);
+      }
+    }
+    WHEN ("We call parallel_merge_sort with 1 thread")
+    {
+      SortUtils::parallel_merge_sort (v.begin (), v.end (), 1);
+      THEN ("[5] We get the right answer")
+      {
+        REQUIRE (expected == v);
+      }
+    }
+  }
+  GIVEN ("A vector smaller than one insertion sort run")
+  {
+    std::vector<int> v {5, 3, 9, 1, 3};
+    WHEN ("We call parallel_merge_sort")
+    {
+      SortUtils::parallel_merge_sort (v.begin (), v.end ());
+      THEN ("[5] We get the right answer")
+      {
+        REQUIRE (v == std::vector<int> {1, 3, 3, 5, 9});
+      }
+    }
+  }
+}
+
+SCENARIO ("bottom_up_merge_sort works", "[bottom_up_merge_sort]")
+{
+  GIVEN ("A vector of some size")
+  {
+    std::vector<int> v (31);
+    std::iota (v.begin (), v.begin () + v.size() / 2, 1);
+    std::iota (v.begin() + v.size() / 2, v.end(), v.size() / 4);
+    std::vector<int> expected (v);
+    std::sort (expected.begin(), expected.end());
+    std::shuffle (v.begin (), v.end (), std::minstd_rand{2047});
+    WHEN ("We call bottom_up_merge_sort")
+    {
+      SortUtils::bottom_up_merge_sort (v.begin (), v.end ());
+      THEN ("[10] We get the right answer")
+      {
+        REQUIRE (expected == v);
+      }
+    }
+  }
+  GIVEN ("Vectors of every size up to a few runs, and one much larger")
+  {
+    std::vector<size_t> sizes (70);
+    std::iota (sizes.begin (), sizes.end (), 1);
+    sizes.push_back (10007);
+    WHEN ("We call bottom_up_merge_sort on each")
+    {
+      THEN ("[10] Every one comes out sorted, whether the number of passes "
+            "is even or odd")
+      {
+        for (size_t size : sizes)
+        {
+          std::vector<int> v (size);
+          std::iota (v.begin (), v.end (), 0);
+          std::vector<int> expected (v);
+          std::shuffle (v.begin (), v.end (), std::minstd_rand{2047});
+          SortUtils::bottom_up_merge_sort (v.begin (), v.end ());
+          INFO ("size " << size);
+          REQUIRE (expected == v);
+        }
+      }
+    }
+  }
+}
+
 
 SCENARIO ("quick_sort works", "[quick_sort]")
 {
@@ -347,3 +486,953 @@ SCENARIO ("quick_sort works", "[quick_sort]")
     }
   }
 }
+
+SCENARIO ("heap_sort works", "[heap_sort]")
+{
+  GIVEN ("A vector of some size")
+  {
+    std::vector<int> v (31);
+    std::iota (v.begin (), v.begin () + v.size() / 2, 1);
+    std::iota (v.begin() + v.size() / 2, v.end(), v.size() / 4);
+    std::vector<int> expected (v);
+    std::sort (expected.begin(), expected.end());
+    std::shuffle (v.begin (), v.end (), std::minstd_rand{2047});
+    WHEN ("We call heap_sort")
+    {
+      SortUtils::heap_sort (v.begin (), v.end ());
+      THEN ("[5] We get the right answer")
+      {
+        REQUIRE (expected == v);
+      }
+    }
+  }
+}
+
+// McIlroy's "killer adversary" for comparison sorts: every element starts
+// as "gas" (larger than any value decided so far) and is only frozen to a
+// value when a comparison forces it, always against the sort's likely
+// pivot. Sorting Adversary items builds an input that is worst case for
+// that sort, which can then be replayed with the values fixed. Comparisons
+// are made one at a time, so it also works against the parallel sorts.
+struct Adversary
+{
+  static inline std::mutex lock;
+  static inline std::vector<int> values;
+  static inline int gas = 0;
+  static inline int frozen = 0;
+  static inline int candidate = 0;
+  static inline long comparisons = 0;
+
+  int index;
+
+  static int
+  compare (int x, int y)
+  {
+    std::lock_guard<std::mutex> guard (lock);
+    ++comparisons;
+    if (values[x] == gas && values[y] == gas)
+    {
+      values[x == candidate ? x : y] = frozen++;
+    }
+    if (values[x] == gas)
+      candidate = x;
+    else if (values[y] == gas)
+      candidate = y;
+    return values[x] - values[y];
+  }
+
+  bool
+  operator< (Adversary const& o) const
+  {
+    return compare (index, o.index) < 0;
+  }
+
+  bool
+  operator> (Adversary const& o) const
+  {
+    return compare (index, o.index) > 0;
+  }
+
+  bool
+  operator<= (Adversary const& o) const
+  {
+    return compare (index, o.index) <= 0;
+  }
+};
+
+SCENARIO ("intro_sort works", "[intro_sort]")
+{
+  GIVEN ("A vector of some size")
+  {
+    std::vector<int> v (31);
+    std::iota (v.begin (), v.begin () + v.size() / 2, 1);
+    std::iota (v.begin() + v.size() / 2, v.end(), v.size() / 4);
+    std::vector<int> expected (v);
+    std::sort (expected.begin(), expected.end());
+    std::shuffle (v.begin (), v.end (), std::minstd_rand{2047});
+    WHEN ("We call intro_sort")
+    {
+      SortUtils::intro_sort (v.begin (), v.end ());
+      THEN ("[10] We get the right answer")
+      {
+        REQUIRE (expected == v);
+      }
+    }
+  }
+  GIVEN ("An input built to make quick_sort take quadratic time")
+  {
+    const int N = 2048;
+    std::vector<Adversary> items (N);
+    for (int i = 0; i < N; ++i)
+      items[i].index = i;
+    Adversary::values.assign (N, N);
+    Adversary::gas = N;
+    Adversary::frozen = 0;
+    SortUtils::quick_sort (items.begin (), items.end ());
+    for (int& value : Adversary::values)
+      if (value == N)
+        value = Adversary::frozen++;
+    // Replay with every value fixed: nothing is gas any more
+    Adversary::gas = -1;
+    const long bound = 10L * N * 11;  // 10 N log2 N
+    WHEN ("We call quick_sort and intro_sort on it")
+    {
+      for (int i = 0; i < N; ++i)
+        items[i].index = i;
+      Adversary::comparisons = 0;
+      SortUtils::quick_sort (items.begin (), items.end ());
+      long quickComparisons = Adversary::comparisons;
+
+      for (int i = 0; i < N; ++i)
+        items[i].index = i;
+      Adversary::comparisons = 0;
+      SortUtils::intro_sort (items.begin (), items.end ());
+      long introComparisons = Adversary::comparisons;
+      THEN ("[10] intro_sort stays O(N log N) where quick_sort does not")
+      {
+        INFO ("quick_sort " << quickComparisons << ", intro_sort "
+              << introComparisons << " comparisons");
+        REQUIRE (quickComparisons > bound);
+        REQUIRE (introComparisons < bound);
+      }
+      THEN ("[5] intro_sort still sorts it")
+      {
+        bool sorted = true;
+        for (int i = 1; i < N; ++i)
+          sorted = sorted && Adversary::values[items[i - 1].index]
+                               < Adversary::values[items[i].index];
+        REQUIRE (sorted);
+      }
+    }
+  }
+}
+
+SCENARIO ("parallel_quick_sort works", "[parallel_quick_sort]")
+{
+  GIVEN ("A vector large enough to be partitioned by several threads")
+  {
+    std::vector<int> v (300007);
+    std::minstd_rand rng (2047);
+    for (int& x : v)
+      x = rng () % 100000;
+    std::vector<int> expected (v);
+    std::sort (expected.begin (), expected.end ());
+    WHEN ("We call parallel_quick_sort with 4 threads")
+    {
+      SortUtils::parallel_quick_sort (v.begin (), v.end (), 4);
+      THEN ("[10] We get the right answer")
+      {
+        REQUIRE (expected == v);
+      }
+    }
+    WHEN ("We sort both halves, then the whole, on one pool of 4 workers")
+    {
+      WorkStealingPool pool (4);
+      SortUtils::parallel_quick_sort (pool, v.begin (), v.begin () + 150000);
+      SortUtils::parallel_quick_sort (pool, v.begin () + 150000, v.end ());
+      SortUtils::parallel_quick_sort (pool, v.begin (), v.end ());
+      THEN ("[5] We get the right answer")
+      {
+        REQUIRE (expected == v);
+      }
+    }
+  }
+}
+
+// An int whose comparisons throw once, on the fuse-th comparison made
+// after the fuse is set, from whichever thread makes it
+struct Fragile
+{
+  static inline std::atomic<long> fuse {0};
+
+  int value;
+
+  static void
+  burn ()
+  {
+    if (fuse.fetch_sub (1) == 1)
+      throw std::runtime_error ("comparison failed");
+  }
+
+  bool
+  operator< (Fragile const& o) const
+  {
+    burn ();
+    return value < o.value;
+  }
+
+  bool
+  operator> (Fragile const& o) const
+  {
+    burn ();
+    return value > o.value;
+  }
+
+  bool
+  operator<= (Fragile const& o) const
+  {
+    burn ();
+    return value <= o.value;
+  }
+};
+
+SCENARIO ("TaskGroup passes on exceptions", "[parallel]")
+{
+  GIVEN ("A pool and a group where one of many tasks throws")
+  {
+    WorkStealingPool pool (4);
+    TaskGroup group (pool);
+    std::atomic<int> finished {0};
+    for (int i = 0; i < 100; ++i)
+    {
+      group.run ([&finished, i] {
+        if (i == 37)
+          throw std::runtime_error ("task 37");
+        ++finished;
+      });
+    }
+    THEN ("[5] wait returns, rethrowing it, after every other task ran")
+    {
+      REQUIRE_THROWS_AS (group.wait (), std::runtime_error);
+      REQUIRE (finished == 99);
+      REQUIRE_NOTHROW (group.wait ());
+    }
+  }
+  GIVEN ("A vector big enough to be partitioned by all the workers")
+  {
+    std::vector<Fragile> v (300007);
+    std::minstd_rand rng (2047);
+    for (Fragile& x : v)
+      x.value = rng () % 100000;
+    WHEN ("One comparison in the first parallel_partition throws")
+    {
+      Fragile::fuse = 1000;
+      THEN ("[5] parallel_quick_sort rethrows it")
+      {
+        REQUIRE_THROWS_AS (SortUtils::parallel_quick_sort (v.begin (),
+                                                           v.end (), 4),
+                           std::runtime_error);
+      }
+      Fragile::fuse = 0;
+    }
+  }
+  GIVEN ("Sorted vectors big enough to be merged by all the workers")
+  {
+    std::vector<std::vector<Fragile>> ranges (8);
+    size_t total = 0;
+    for (size_t i = 0; i < ranges.size (); ++i)
+    {
+      for (int j = 0; j < 20000; ++j)
+        ranges[i].push_back (Fragile {j * 8 + int (i)});
+      total += ranges[i].size ();
+    }
+    WHEN ("One comparison in one of the slices throws")
+    {
+      std::vector<Fragile> v (total);
+      Fragile::fuse = 20000;
+      THEN ("[5] parallel_kway_merge rethrows it")
+      {
+        REQUIRE_THROWS_AS (SortUtils::parallel_kway_merge (ranges, v.begin (),
+                                                           4),
+                           std::runtime_error);
+      }
+      Fragile::fuse = 0;
+    }
+  }
+}
+
+SCENARIO ("parallel_nth_element works", "[parallel_nth_element]")
+{
+  GIVEN ("A large shuffled vector of distinct values")
+  {
+    std::vector<int> v (300007);
+    std::iota (v.begin (), v.end (), 0);
+    std::shuffle (v.begin (), v.end (), std::minstd_rand{2047});
+    size_t const index = GENERATE (0, 1000, 150003, 300006);
+    WHEN ("We call parallel_nth_element with 4 threads")
+    {
+      auto result = SortUtils::parallel_nth_element (v.begin (), v.end (),
+                                                     index, 4);
+      THEN ("[5] We get the right element at the right place")
+      {
+        REQUIRE (*result == int (index));
+        REQUIRE (size_t (result - v.begin ()) == index);
+      }
+    }
+  }
+  GIVEN ("An adversary that decides the input while it runs")
+  {
+    const int N = 100000;
+    std::vector<Adversary> items (N);
+    for (int i = 0; i < N; ++i)
+      items[i].index = i;
+    Adversary::values.assign (N, N);
+    Adversary::gas = N;
+    Adversary::frozen = 0;
+    Adversary::comparisons = 0;
+    WHEN ("We call parallel_nth_element for the median with 4 threads")
+    {
+      SortUtils::parallel_nth_element (items.begin (), items.end (), N / 2,
+                                       4);
+      THEN ("[5] The number of comparisons stays linear")
+      {
+        INFO (Adversary::comparisons << " comparisons");
+        REQUIRE (Adversary::comparisons < 50L * N);
+      }
+    }
+  }
+}
+
+// The signs of the zeros in v, in order
+template<typename T>
+std::vector<bool>
+zeroSigns (std::vector<T> const& v)
+{
+  std::vector<bool> signs;
+  for (T x : v)
+    if (x == T (0))
+      signs.push_back (std::signbit (x));
+  return signs;
+}
+
+SCENARIO ("radix_sort works", "[radix_sort]")
+{
+  std::mt19937_64 rng (2047);
+  size_t const size = GENERATE (100, 5000, 100000);
+  GIVEN ("Signed ints, including the extremes")
+  {
+    std::vector<int> v (size);
+    for (int& x : v)
+      x = rng ();
+    v[0] = std::numeric_limits<int>::min ();
+    v[1] = std::numeric_limits<int>::max ();
+    v[2] = 0;
+    v[3] = -1;
+    std::vector<int> expected (v);
+    std::sort (expected.begin (), expected.end ());
+    WHEN ("We call radix_sort")
+    {
+      SortUtils::radix_sort (v.begin (), v.end ());
+      THEN ("[5] We get the right answer")
+      {
+        REQUIRE (expected == v);
+      }
+    }
+  }
+  GIVEN ("Unsigned 64 bit keys and 16 bit keys")
+  {
+    std::vector<std::uint64_t> wide (size);
+    for (auto& x : wide)
+      x = rng ();
+    std::vector<std::int16_t> narrow (size);
+    for (auto& x : narrow)
+      x = rng ();
+    auto expectedWide (wide);
+    std::sort (expectedWide.begin (), expectedWide.end ());
+    auto expectedNarrow (narrow);
+    std::sort (expectedNarrow.begin (), expectedNarrow.end ());
+    WHEN ("We call radix_sort on each")
+    {
+      SortUtils::radix_sort (wide.begin (), wide.end ());
+      SortUtils::radix_sort (narrow.begin (), narrow.end ());
+      THEN ("[5] We get the right answers")
+      {
+        REQUIRE (expectedWide == wide);
+        REQUIRE (expectedNarrow == narrow);
+      }
+    }
+  }
+  GIVEN ("Floats and doubles of both signs")
+  {
+    std::uniform_real_distribution<double> dist (-1e6, 1e6);
+    std::vector<float> f (size);
+    for (float& x : f)
+      x = dist (rng);
+    std::vector<double> d (size);
+    for (double& x : d)
+      x = dist (rng);
+    f[0] = -std::numeric_limits<float>::infinity ();
+    f[1] = std::numeric_limits<float>::infinity ();
+    f[2] = -0.5f;
+    d[0] = std::numeric_limits<double>::lowest ();
+    d[1] = std::numeric_limits<double>::denorm_min ();
+    auto expectedF (f);
+    std::sort (expectedF.begin (), expectedF.end ());
+    auto expectedD (d);
+    std::sort (expectedD.begin (), expectedD.end ());
+    WHEN ("We call radix_sort on each")
+    {
+      SortUtils::radix_sort (f.begin (), f.end ());
+      SortUtils::radix_sort (d.begin (), d.end ());
+      THEN ("[5] We get the right answers")
+      {
+        REQUIRE (expectedF == f);
+        REQUIRE (expectedD == d);
+      }
+    }
+  }
+  GIVEN ("Floats and doubles where -0.0 and +0.0, which compare equal, "
+         "are mixed")
+  {
+    std::vector<float> f (size);
+    for (float& x : f)
+      x = float (rng () % 3) - 1.0f;
+    std::vector<double> d (size);
+    for (double& x : d)
+      x = double (rng () % 3) - 1.0;
+    for (size_t i = 0; i < size; i += 2)
+    {
+      f[i] = f[i] == 0.0f ? -0.0f : f[i];
+      d[i] = d[i] == 0.0 ? -0.0 : d[i];
+    }
+    auto signsF = zeroSigns (f);
+    auto signsD = zeroSigns (d);
+    WHEN ("We call radix_sort on each")
+    {
+      SortUtils::radix_sort (f.begin (), f.end ());
+      SortUtils::radix_sort (d.begin (), d.end ());
+      THEN ("[5] They are sorted with the zeros in their input order")
+      {
+        REQUIRE (std::is_sorted (f.begin (), f.end ()));
+        REQUIRE (std::is_sorted (d.begin (), d.end ()));
+        REQUIRE (zeroSigns (f) == signsF);
+        REQUIRE (zeroSigns (d) == signsD);
+      }
+    }
+  }
+}
+
+SCENARIO ("sort picks a sort for the value type", "[sort]")
+{
+  GIVEN ("Ints, which are radix sorted, and strings, which are not")
+  {
+    std::vector<int> v (1000);
+    std::iota (v.begin (), v.end (), -500);
+    std::vector<int> expected (v);
+    std::shuffle (v.begin (), v.end (), std::minstd_rand{2047});
+    std::vector<std::string> words {"pear", "apple", "fig", "kiwi", "date"};
+    WHEN ("We call sort on both")
+    {
+      SortUtils::sort (v.begin (), v.end ());
+      SortUtils::sort (words.begin (), words.end ());
+      THEN ("[5] We get the right answers")
+      {
+        REQUIRE (expected == v);
+        REQUIRE (words == std::vector<std::string> {"apple", "date", "fig",
+                                                    "kiwi", "pear"});
+      }
+    }
+  }
+}
+
+SCENARIO ("small_sort works", "[small_sort]")
+{
+  std::mt19937 rng (2047);
+  GIVEN ("Every length a sorting network takes, with duplicates")
+  {
+    WHEN ("We call small_sort on ints, unsigneds and floats")
+    {
+      THEN ("[5] Every one comes out sorted")
+      {
+        for (size_t size = 0; size <= 40; ++size)
+        {
+          std::vector<int> i (size);
+          std::vector<unsigned> u (size);
+          std::vector<float> f (size);
+          for (size_t k = 0; k < size; ++k)
+          {
+            i[k] = int (rng () % 16) - 8;
+            u[k] = rng () % 2 ? rng () : 3u;
+            f[k] = float (int (rng () % 100) - 50) / 4;
+          }
+          auto expectedI (i);
+          auto expectedU (u);
+          auto expectedF (f);
+          std::sort (expectedI.begin (), expectedI.end ());
+          std::sort (expectedU.begin (), expectedU.end ());
+          std::sort (expectedF.begin (), expectedF.end ());
+          SortUtils::small_sort (i.begin (), i.end ());
+          SortUtils::small_sort (u.begin (), u.end ());
+          SortUtils::small_sort (f.begin (), f.end ());
+          INFO ("size " << size);
+          REQUIRE (expectedI == i);
+          REQUIRE (expectedU == u);
+          REQUIRE (expectedF == f);
+        }
+      }
+    }
+  }
+}
+
+SCENARIO ("select works", "[select]")
+{
+  std::mt19937 rng (2047);
+  size_t const size = GENERATE (20, 1000, 100000);
+  GIVEN ("Random, sorted, few-valued and organ pipe inputs")
+  {
+    std::vector<std::vector<int>> inputs (4, std::vector<int> (size));
+    for (size_t i = 0; i < size; ++i)
+    {
+      inputs[0][i] = rng ();
+      inputs[1][i] = i;
+      inputs[2][i] = rng () % 7;
+      inputs[3][i] = i < size / 2 ? i : size - i;
+    }
+    size_t const index = rng () % size;
+    WHEN ("We call select")
+    {
+      THEN ("[10] The element of that rank is in place")
+      {
+        for (std::vector<int> v : inputs)
+        {
+          std::vector<int> sorted (v);
+          std::sort (sorted.begin (), sorted.end ());
+          auto result = SortUtils::select (v.begin (), v.end (), index);
+          REQUIRE (size_t (result - v.begin ()) == index);
+          REQUIRE (*result == sorted[index]);
+          for (auto i = v.begin (); i != result; ++i)
+            REQUIRE (*i <= *result);
+          for (auto i = result; i != v.end (); ++i)
+            REQUIRE (*i >= *result);
+        }
+      }
+    }
+    WHEN ("We use the median-of-medians fallback on its own")
+    {
+      THEN ("[5] It finds the same element")
+      {
+        for (std::vector<int> v : inputs)
+        {
+          std::vector<int> sorted (v);
+          std::sort (sorted.begin (), sorted.end ());
+          auto result = SortUtils::detail::median_of_medians_select (
+            v.begin (), v.end (), index);
+          REQUIRE (*result == sorted[index]);
+        }
+      }
+    }
+  }
+  GIVEN ("An adversary that decides the input while select runs")
+  {
+    const int N = 20000;
+    std::vector<Adversary> items (N);
+    for (int i = 0; i < N; ++i)
+      items[i].index = i;
+    Adversary::values.assign (N, N);
+    Adversary::gas = N;
+    Adversary::frozen = 0;
+    Adversary::comparisons = 0;
+    WHEN ("We select the median")
+    {
+      SortUtils::select (items.begin (), items.end (), N / 2);
+      THEN ("[5] The number of comparisons stays linear")
+      {
+        INFO (Adversary::comparisons << " comparisons");
+        REQUIRE (Adversary::comparisons < 50L * N);
+      }
+    }
+  }
+}
+
+SCENARIO ("multi_select works", "[multi_select]")
+{
+  GIVEN ("A large shuffled vector of distinct values")
+  {
+    std::vector<int> v (100000);
+    std::iota (v.begin (), v.end (), 0);
+    std::shuffle (v.begin (), v.end (), std::minstd_rand{2047});
+    size_t const n = v.size ();
+    WHEN ("We ask for p50, p90 and p99 (and p50 again)")
+    {
+      std::vector<size_t> ranks {n / 2, n * 9 / 10, n * 99 / 100, n / 2};
+      auto result = SortUtils::multi_select (v.begin (), v.end (), ranks);
+      THEN ("[10] Each rank is in place and returned in order")
+      {
+        REQUIRE (result.size () == ranks.size ());
+        for (size_t i = 0; i < ranks.size (); ++i)
+        {
+          REQUIRE (size_t (result[i] - v.begin ()) == ranks[i]);
+          REQUIRE (size_t (*result[i]) == ranks[i]);
+        }
+      }
+    }
+  }
+}
+
+// A key with a tag that is not compared, to check sorts for stability
+struct Tagged
+{
+  int key;
+  int tag;
+
+  bool
+  operator< (Tagged const& o) const
+  {
+    return key < o.key;
+  }
+
+  bool
+  operator> (Tagged const& o) const
+  {
+    return key > o.key;
+  }
+
+  bool
+  operator<= (Tagged const& o) const
+  {
+    return key <= o.key;
+  }
+};
+
+SCENARIO ("adaptive_merge_sort works", "[adaptive_merge_sort]")
+{
+  std::mt19937 rng (2047);
+  size_t const size = GENERATE (0, 1, 31, 100, 5000, 100000);
+  GIVEN ("Random, sorted, reversed, sawtooth and nearly sorted inputs")
+  {
+    std::vector<std::vector<int>> inputs (5, std::vector<int> (size));
+    for (size_t i = 0; i < size; ++i)
+    {
+      inputs[0][i] = rng ();
+      inputs[1][i] = i;
+      inputs[2][i] = size - i;
+      inputs[3][i] = i % 1000;
+      inputs[4][i] = i;
+    }
+    for (size_t i = 0; i + 1 < size; i += 97)
+      std::swap (inputs[4][i], inputs[4][i + 1]);
+    WHEN ("We call adaptive_merge_sort")
+    {
+      THEN ("[10] We get the right answer")
+      {
+        for (std::vector<int> v : inputs)
+        {
+          std::vector<int> expected (v);
+          std::sort (expected.begin (), expected.end ());
+          SortUtils::adaptive_merge_sort (v.begin (), v.end ());
+          REQUIRE (expected == v);
+        }
+      }
+    }
+  }
+  GIVEN ("Few distinct keys, tagged with their original positions")
+  {
+    std::vector<Tagged> v (size);
+    for (size_t i = 0; i < size; ++i)
+    {
+      // Long runs with equal keys on both sides of every run boundary
+      int key = (i / 300) % 2 ? 4 - int (i % 5) : int (rng () % 5);
+      v[i] = Tagged {key, int (i)};
+    }
+    WHEN ("We call adaptive_merge_sort")
+    {
+      SortUtils::adaptive_merge_sort (v.begin (), v.end ());
+      THEN ("[10] Equal keys keep their original order")
+      {
+        for (size_t i = 1; i < size; ++i)
+        {
+          REQUIRE (v[i - 1].key <= v[i].key);
+          if (v[i - 1].key == v[i].key)
+            REQUIRE (v[i - 1].tag < v[i].tag);
+        }
+      }
+    }
+  }
+}
+
+SCENARIO ("The merge sorts are stable for floats", "[stable]")
+{
+  std::mt19937 rng (2047);
+  size_t const size = GENERATE (5, 31, 100, 5000, 40000);
+  GIVEN ("Floats where -0.0 and +0.0, which compare equal, are mixed")
+  {
+    float const values[] = {-1.0f, -0.0f, 0.0f, 1.0f};
+    std::vector<float> v (size);
+    for (float& x : v)
+      x = values[rng () % 4];
+    std::vector<bool> signs = zeroSigns (v);
+    WHEN ("We call each of the stable sorts")
+    {
+      std::vector<float> merged (v), parallel (v), bottomUp (v), adaptive (v);
+      SortUtils::merge_sort (merged.begin (), merged.end ());
+      SortUtils::parallel_merge_sort (parallel.begin (), parallel.end (), 4);
+      SortUtils::bottom_up_merge_sort (bottomUp.begin (), bottomUp.end ());
+      SortUtils::adaptive_merge_sort (adaptive.begin (), adaptive.end ());
+      THEN ("[10] Every one sorts and keeps the zeros in their input order")
+      {
+        for (auto const* sorted : {&merged, &parallel, &bottomUp, &adaptive})
+        {
+          REQUIRE (std::is_sorted (sorted->begin (), sorted->end ()));
+          REQUIRE (zeroSigns (*sorted) == signs);
+        }
+      }
+    }
+  }
+}
+
+SCENARIO ("kway_merge works", "[kway_merge]")
+{
+  std::mt19937 rng (2047);
+  size_t const k = GENERATE (0, 1, 2, 5, 33);
+  GIVEN ("k sorted vectors of mixed lengths, some empty, with duplicates")
+  {
+    std::vector<std::vector<int>> ranges (k);
+    std::vector<int> expected;
+    for (size_t i = 0; i < k; ++i)
+    {
+      ranges[i].resize (i % 4 == 3 ? 0 : rng () % 2000);
+      for (int& x : ranges[i])
+        x = int (rng () % 500);
+      std::sort (ranges[i].begin (), ranges[i].end ());
+      expected.insert (expected.end (), ranges[i].begin (), ranges[i].end ());
+    }
+    std::sort (expected.begin (), expected.end ());
+    WHEN ("We call kway_merge")
+    {
+      std::vector<int> v (expected.size ());
+      auto end = SortUtils::kway_merge (ranges, v.begin ());
+      THEN ("[10] The output is every element in order")
+      {
+        REQUIRE (end == v.end ());
+        REQUIRE (expected == v);
+      }
+    }
+    WHEN ("We call parallel_kway_merge with 4 threads")
+    {
+      std::vector<int> v (expected.size ());
+      auto end = SortUtils::parallel_kway_merge (ranges, v.begin (), 4);
+      THEN ("[10] The output is every element in order")
+      {
+        REQUIRE (end == v.end ());
+        REQUIRE (expected == v);
+      }
+    }
+    WHEN ("We call parallel_kway_merge on a pool of 4 workers")
+    {
+      WorkStealingPool pool (4);
+      std::vector<int> v (expected.size ());
+      auto end = SortUtils::parallel_kway_merge (pool, ranges, v.begin ());
+      THEN ("[5] The output is every element in order")
+      {
+        REQUIRE (end == v.end ());
+        REQUIRE (expected == v);
+      }
+    }
+  }
+  GIVEN ("k large sorted vectors of few distinct keys, tagged by range")
+  {
+    std::vector<std::vector<Tagged>> ranges (k);
+    size_t total = 0;
+    for (size_t i = 0; i < k; ++i)
+    {
+      std::vector<int> keys (10000 + rng () % 10000);
+      for (int& x : keys)
+        x = int (rng () % 5);
+      std::sort (keys.begin (), keys.end ());
+      for (size_t j = 0; j < keys.size (); ++j)
+        ranges[i].push_back (Tagged {keys[j], int (i * 100000 + j)});
+      total += keys.size ();
+    }
+    WHEN ("We call parallel_kway_merge with 4 threads")
+    {
+      std::vector<Tagged> v (total);
+      SortUtils::parallel_kway_merge (ranges, v.begin (), 4);
+      THEN ("[10] Equal keys come out in range order, then original order")
+      {
+        for (size_t i = 1; i < total; ++i)
+        {
+          REQUIRE (v[i - 1].key <= v[i].key);
+          if (v[i - 1].key == v[i].key)
+            REQUIRE (v[i - 1].tag < v[i].tag);
+        }
+        std::vector<Tagged> serial (total);
+        SortUtils::kway_merge (ranges, serial.begin ());
+        for (size_t i = 0; i < total; ++i)
+          REQUIRE (serial[i].tag == v[i].tag);
+      }
+    }
+  }
+}
+
+// A file with a unique name in the temp directory, so concurrent runs
+// cannot collide, that is removed when it goes out of scope, even if a
+// REQUIRE fails first
+struct TempFile
+{
+  std::string path;
+
+  explicit TempFile (std::string const& prefix)
+  {
+    path = (std::filesystem::temp_directory_path () / (prefix + ".XXXXXX"))
+      .string ();
+    ::close (::mkstemp (path.data ()));
+  }
+
+  TempFile (TempFile const&) = delete;
+
+  ~TempFile ()
+  {
+    std::filesystem::remove (path);
+  }
+};
+
+// Replace the contents of path with records
+template<typename T>
+void
+writeRecords (std::string const& path, std::vector<T> const& records)
+{
+  std::ofstream file (path, std::ios::binary | std::ios::trunc);
+  file.write (reinterpret_cast<char const*> (records.data ()),
+              records.size () * sizeof (T));
+}
+
+template<typename T>
+std::vector<T>
+readRecords (std::string const& path)
+{
+  std::vector<T> records (std::filesystem::file_size (path) / sizeof (T));
+  std::ifstream file (path, std::ios::binary);
+  file.read (reinterpret_cast<char*> (records.data ()),
+             records.size () * sizeof (T));
+  return records;
+}
+
+// A fixed-width record ordered by its key alone
+struct KeyedRecord
+{
+  std::uint64_t key;
+  std::uint64_t payload;
+
+  bool
+  operator< (KeyedRecord const& o) const
+  {
+    return key < o.key;
+  }
+
+  bool
+  operator> (KeyedRecord const& o) const
+  {
+    return key > o.key;
+  }
+
+  bool
+  operator<= (KeyedRecord const& o) const
+  {
+    return key <= o.key;
+  }
+};
+
+SCENARIO ("external_sort works", "[external_sort]")
+{
+  std::mt19937_64 rng (2047);
+  std::string const temp = std::filesystem::temp_directory_path ().string ();
+  TempFile const outputFile ("external_sort_out");
+  std::string const& output = outputFile.path;
+  GIVEN ("A file of 100000 random uint64 keys")
+  {
+    std::vector<std::uint64_t> v (100000);
+    for (auto& x : v)
+      x = rng ();
+    TempFile inputFile ("external_sort_in");
+    std::string const& input = inputFile.path;
+    writeRecords (input, v);
+    std::vector<std::uint64_t> expected (v);
+    std::sort (expected.begin (), expected.end ());
+    // 64 KiB makes 37 runs merged two at a time; 16 MiB fits in one chunk
+    std::size_t const memory = GENERATE (std::size_t (1) << 16,
+                                         std::size_t (1) << 20,
+                                         std::size_t (1) << 24);
+    unsigned const threads = GENERATE (1u, 4u);
+    WHEN ("We call external_sort")
+    {
+      SortUtils::ExternalSortOptions options;
+      options.memory = memory;
+      options.tempDirectory = temp;
+      options.threads = threads;
+      std::size_t count =
+        SortUtils::external_sort<std::uint64_t> (input, output, options);
+      THEN ("[10] The output file holds every key in order")
+      {
+        REQUIRE (count == v.size ());
+        REQUIRE (readRecords<std::uint64_t> (output) == expected);
+      }
+    }
+  }
+  GIVEN ("A file of records with few distinct keys and unique payloads")
+  {
+    std::vector<KeyedRecord> v (50000);
+    for (std::size_t i = 0; i < v.size (); ++i)
+      v[i] = KeyedRecord {rng () % 100, i};
+    TempFile inputFile ("external_sort_in");
+    std::string const& input = inputFile.path;
+    writeRecords (input, v);
+    WHEN ("We call external_sort with little memory")
+    {
+      SortUtils::ExternalSortOptions options;
+      options.memory = std::size_t (1) << 18;
+      options.tempDirectory = temp;
+      SortUtils::external_sort<KeyedRecord> (input, output, options);
+      THEN ("[10] The keys are in order and every record is there once")
+      {
+        std::vector<KeyedRecord> result = readRecords<KeyedRecord> (output);
+        REQUIRE (result.size () == v.size ());
+        std::vector<bool> seen (v.size (), false);
+        for (std::size_t i = 0; i < result.size (); ++i)
+        {
+          if (i > 0)
+            REQUIRE (result[i - 1].key <= result[i].key);
+          REQUIRE (result[i].key == v[result[i].payload].key);
+          REQUIRE (!seen[result[i].payload]);
+          seen[result[i].payload] = true;
+        }
+      }
+    }
+  }
+  GIVEN ("An empty file and a file with a partial record")
+  {
+    TempFile emptyFile ("external_sort_empty");
+    TempFile partialFile ("external_sort_partial");
+    std::string const& empty = emptyFile.path;
+    std::string const& partial = partialFile.path;
+    writeRecords (partial, std::vector<std::uint32_t> {1, 2, 3});
+    THEN ("[5] The empty file sorts to an empty file")
+    {
+      REQUIRE (SortUtils::external_sort<std::uint64_t> (empty, output) == 0);
+      REQUIRE (std::filesystem::file_size (output) == 0);
+    }
+    THEN ("[5] The partial record is an error")
+    {
+      REQUIRE_THROWS_AS (
+        SortUtils::external_sort<std::uint64_t> (partial, output),
+        std::invalid_argument);
+    }
+    THEN ("[5] Sorting a file onto itself is an error that keeps the file")
+    {
+      REQUIRE_THROWS_AS (
+        SortUtils::external_sort<std::uint32_t> (partial, partial),
+        std::invalid_argument);
+      REQUIRE (readRecords<std::uint32_t> (partial)
+               == std::vector<std::uint32_t> {1, 2, 3});
+    }
+  }
+}
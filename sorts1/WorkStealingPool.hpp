@@ -0,0 +1,230 @@
+// File: WorkStealingPool.hpp
+// Author: Jaysen Hippensteel
+//
+// A fixed set of worker threads, each with its own deque of tasks. A worker
+// pushes and pops tasks at the back of its own deque (newest first, which
+// keeps divide and conquer work cache warm) and, when that is empty, steals
+// from the front of another worker's deque (oldest first, which are the
+// biggest pieces of a divide and conquer job). TaskGroup waits for a set of
+// tasks and runs pending tasks itself while it waits, so a task can wait on
+// tasks it spawned without tying up a worker.
+
+#ifndef WORK_STEALING_POOL_HPP_
+#define WORK_STEALING_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool
+{
+public:
+
+  // Start threads workers (0 means one per hardware thread)
+  explicit WorkStealingPool (unsigned threads = 0)
+  {
+    if (threads == 0){
+      threads = std::thread::hardware_concurrency ();
+      if (threads == 0) threads = 1;
+    }
+    for (unsigned i = 0; i < threads; ++i){
+      m_queues.push_back (std::make_unique<Queue> ());
+    }
+    for (unsigned i = 0; i < threads; ++i){
+      m_workers.emplace_back ([this, i] { work (i); });
+    }
+  }
+
+  WorkStealingPool (const WorkStealingPool&) = delete;
+
+  WorkStealingPool&
+  operator= (const WorkStealingPool&) = delete;
+
+  // Finishes every task already submitted, then joins the workers
+  ~WorkStealingPool ()
+  {
+    {
+      std::lock_guard<std::mutex> lock (m_sleepMutex);
+      m_stop = true;
+    }
+    m_wake.notify_all ();
+    for (std::thread& worker : m_workers){
+      worker.join ();
+    }
+  }
+
+  unsigned
+  size () const
+  {
+    return m_queues.size ();
+  }
+
+  // Queue task on the calling worker's own deque, or spread tasks from
+  // other threads over the workers round robin
+  void
+  submit (std::function<void ()> task)
+  {
+    unsigned index = (t_pool == this) ? t_index
+      : m_next.fetch_add (1, std::memory_order_relaxed) % size ();
+    {
+      std::lock_guard<std::mutex> lock (m_queues[index]->mutex);
+      m_queues[index]->tasks.push_back (std::move (task));
+    }
+    m_pending.fetch_add (1);
+    {
+      // Taking the lock orders this with a worker about to sleep, so the
+      // notify cannot fall between its check and its wait
+      std::lock_guard<std::mutex> lock (m_sleepMutex);
+    }
+    m_wake.notify_one ();
+  }
+
+  // Run one pending task on the calling thread: the newest from its own
+  // deque if it is a worker, otherwise one stolen from another deque.
+  // Returns false if there was nothing to run.
+  bool
+  runOne ()
+  {
+    std::function<void ()> task;
+    bool worker = (t_pool == this);
+    if (worker){
+      Queue& own = *m_queues[t_index];
+      std::lock_guard<std::mutex> lock (own.mutex);
+      if (!own.tasks.empty ()){
+        task = std::move (own.tasks.back ());
+        own.tasks.pop_back ();
+      }
+    }
+    unsigned start = worker ? t_index + 1 : 0;
+    for (unsigned k = 0; !task && k < size (); ++k){
+      Queue& victim = *m_queues[(start + k) % size ()];
+      std::lock_guard<std::mutex> lock (victim.mutex);
+      if (!victim.tasks.empty ()){
+        task = std::move (victim.tasks.front ());
+        victim.tasks.pop_front ();
+      }
+    }
+    if (!task) return false;
+    m_pending.fetch_sub (1);
+    task ();
+    return true;
+  }
+
+private:
+
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<std::function<void ()>> tasks;
+  };
+
+  void
+  work (unsigned index)
+  {
+    t_pool = this;
+    t_index = index;
+    while (true){
+      if (runOne ()) continue;
+      std::unique_lock<std::mutex> lock (m_sleepMutex);
+      m_wake.wait (lock, [this] { return m_stop || m_pending.load () > 0; });
+      if (m_stop && m_pending.load () == 0) return;
+    }
+  }
+
+  // Which pool, if any, the current thread works for, and its deque
+  static inline thread_local WorkStealingPool* t_pool = nullptr;
+  static inline thread_local unsigned t_index = 0;
+
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<std::thread> m_workers;
+  std::atomic<unsigned> m_next {0};
+  std::atomic<std::size_t> m_pending {0};
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wake;
+  bool m_stop = false;
+};
+
+// A set of tasks run on a pool that can be waited for together. If a task
+// throws, the first exception is kept and rethrown by wait ().
+class TaskGroup
+{
+public:
+
+  explicit TaskGroup (WorkStealingPool& pool)
+    : m_pool (pool)
+  {
+  }
+
+  TaskGroup (const TaskGroup&) = delete;
+
+  TaskGroup&
+  operator= (const TaskGroup&) = delete;
+
+  // Waits for the tasks but drops any exception, since a destructor
+  // cannot throw; call wait () first to see it
+  ~TaskGroup ()
+  {
+    finish ();
+  }
+
+  template<typename Function>
+  void
+  run (Function task)
+  {
+    m_count.fetch_add (1);
+    m_pool.submit ([this, task] {
+      try {
+        task ();
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lock (m_errorMutex);
+        if (!m_error){
+          m_error = std::current_exception ();
+        }
+      }
+      m_count.fetch_sub (1);
+    });
+  }
+
+  // Return once every task run has finished, running pending tasks (from
+  // this group or any other) in the meantime. Rethrows the first exception
+  // a task threw.
+  void
+  wait ()
+  {
+    finish ();
+    std::exception_ptr error;
+    {
+      std::lock_guard<std::mutex> lock (m_errorMutex);
+      std::swap (error, m_error);
+    }
+    if (error){
+      std::rethrow_exception (error);
+    }
+  }
+
+private:
+
+  void
+  finish ()
+  {
+    while (m_count.load () != 0){
+      if (!m_pool.runOne ()){
+        std::this_thread::yield ();
+      }
+    }
+  }
+
+  WorkStealingPool& m_pool;
+  std::atomic<std::size_t> m_count {0};
+  std::mutex m_errorMutex;
+  std::exception_ptr m_error;
+};
+
+#endif